@@ -0,0 +1,420 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "boids.h"
+#include "boids_kernels.h"
+#include "fastmath.h"
+#include "flock.h"
+#include "grid.h"
+#include "config.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+// Microbenchmarks for the individual simulation kernels.
+//
+// Every kernel variant runs against the same synthetic flocks so numbers
+// are directly comparable. Each measurement does a few untimed warmup runs,
+// then REPETITIONS timed runs, and reports min and median time per op.
+// Cycles are TSC reference cycles, not core clock cycles.
+
+#define WARMUP 3
+#define REPETITIONS 21
+#define QUERIES 1024 // boids queried per run for the neighbor kernels
+#define TILE_CELLS 4 // default tile width in grid cells for the tiled flock step
+#define PREDATORS 10 // percent of the mixed flock
+#define NEIGHBOR_RADIUS 50.0f // the one getLocalFlock uses
+
+static int tileCells = TILE_CELLS;
+
+typedef struct Triangle {
+    BoidVec2 v0, v1, v2;
+} Triangle;
+
+typedef struct Distribution {
+    const char* name;
+    Boid** flock;
+    int count;
+} Distribution;
+
+typedef struct BenchContext {
+    Distribution* dist;
+    LocalFlock* localFlocks; // precomputed for QUERIES boids
+    Triangle* triangles;
+    float* headings; // per boid inputs and outputs for the trig kernels
+    float* dx;
+    float* dy;
+    float* out0;
+    float* out1;
+    volatile float sink;
+    Flock flock; // the same boids as columns, for whole steps
+    Flock mixed; // and again, the last PREDATORS percent of them hunting the rest
+    float* start; // x, y and rotation each step starts from
+    Grid grid; // over flock at the start positions, for the grid queries
+} BenchContext;
+
+typedef struct Kernel {
+    const char* name;
+    const char* variant;
+    void (*run)(BenchContext* ctx);
+    long (*ops)(const BenchContext* ctx);
+    void (*prepare)(BenchContext* ctx); // untimed, before every run
+} Kernel;
+
+static double nowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static unsigned long long nowCycles(void) {
+#ifdef HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+static int compareDouble(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// synthetic flocks
+
+static unsigned int benchSeed;
+
+static float benchRandom(float max) {
+    benchSeed = benchSeed * 1664525u + 1013904223u;
+    return (benchSeed >> 8) * (1.0f / 16777216.0f) * max;
+}
+
+static float wrap(float v, float n) {
+    return v < 0 ? v + n : (v >= n ? v - n : v);
+}
+
+static Boid** makeFlock(const char* kind, int count) {
+    Boid** flock = malloc(sizeof(Boid*) * count);
+    benchSeed = 42690;
+
+    for (int i = 0; i < count; i++) {
+        BoidVec2 origin;
+
+        if (!strcmp(kind, "uniform")) {
+            origin = (BoidVec2){benchRandom(WIDTH), benchRandom(HEIGHT)};
+        } else if (!strcmp(kind, "cluster")) {
+            // everyone inside one neighbor radius, the local flock saturates
+            float r = 40.0f * sqrtf(benchRandom(1.0f));
+            float a = benchRandom(2 * M_PI);
+            origin = (BoidVec2){WIDTH / 2 + r * cosf(a), HEIGHT / 2 + r * sinf(a)};
+        } else {
+            // ring centred on the left edge, half of it wraps to the right
+            float r = 150.0f + benchRandom(20.0f);
+            float a = benchRandom(2 * M_PI);
+            origin = (BoidVec2){wrap(r * cosf(a), WIDTH), wrap(HEIGHT / 2 + r * sinf(a), HEIGHT)};
+        }
+
+        flock[i] = newBoid(origin, (BoidVec2){20, 20}, benchRandom(2 * M_PI), 1);
+    }
+
+    return flock;
+}
+
+static void freeFlock(Boid** flock, int count) {
+    for (int i = 0; i < count; i++) {
+        free(flock[i]->positions);
+        free(flock[i]);
+    }
+    free(flock);
+}
+
+static int queryIndex(const BenchContext* ctx, int q) {
+    return (int)((long)q * ctx->dist->count / QUERIES);
+}
+
+// kernels
+
+static void runLocalFlockBrute(BenchContext* ctx) {
+    Distribution* d = ctx->dist;
+    int total = 0;
+
+    for (int q = 0; q < QUERIES; q++)
+        total += getLocalFlock(d->flock[queryIndex(ctx, q)], d->flock, d->count).size;
+
+    ctx->sink = total;
+}
+
+// rebuild the grid from the start positions, the flock steps move them
+static void prepareGrid(BenchContext* ctx) {
+    int n = ctx->flock.count;
+
+    memcpy(ctx->flock.x, ctx->start, n * sizeof(float));
+    memcpy(ctx->flock.y, ctx->start + n, n * sizeof(float));
+    gridBuild(&ctx->grid, &ctx->flock);
+}
+
+// the same query through the 3x3 cells around the boid, no wrap like the
+// brute force one, stopping at the same cap
+static void runLocalFlockGrid(BenchContext* ctx) {
+    const Grid* grid = &ctx->grid;
+    const float* x = ctx->flock.x;
+    const float* y = ctx->flock.y;
+    int total = 0;
+
+    for (int q = 0; q < QUERIES; q++) {
+        int i = queryIndex(ctx, q);
+        int c0, r0, c1, r1, size = 0;
+        gridCellRect(grid, x[i] - NEIGHBOR_RADIUS, y[i] - NEIGHBOR_RADIUS, x[i] + NEIGHBOR_RADIUS, y[i] + NEIGHBOR_RADIUS, &c0, &r0, &c1, &r1);
+
+        for (int r = r0; r <= r1 && size < localFlockSize; r++) {
+            int begin, end;
+            gridRowRange(grid, r, c0, c1, &begin, &end);
+
+            for (int a = begin; a < end && size < localFlockSize; a++) {
+                int j = grid->indices[a];
+                float dx = x[j] - x[i], dy = y[j] - y[i];
+                if (j != i && dx * dx + dy * dy < NEIGHBOR_RADIUS * NEIGHBOR_RADIUS)
+                    size++;
+            }
+        }
+
+        total += size;
+    }
+
+    ctx->sink = total;
+}
+
+static long opsQueries(const BenchContext* ctx) {
+    (void)ctx;
+    return QUERIES;
+}
+
+static void runSeparation(BenchContext* ctx) {
+    float total = 0;
+
+    for (int q = 0; q < QUERIES; q++)
+        total += getSeparation(ctx->dist->flock[queryIndex(ctx, q)], ctx->localFlocks[q]);
+
+    ctx->sink = total;
+}
+
+static void runRotate(BenchContext* ctx) {
+    Distribution* d = ctx->dist;
+
+    // alternate signs so the triangles do not drift over repetitions
+    for (int i = 0; i < d->count; i++)
+        rotateBoid(d->flock[i], (i & 1) ? 0.01f : -0.01f);
+}
+
+static long opsBoids(const BenchContext* ctx) {
+    return ctx->dist->count;
+}
+
+static void runVertexScalar(BenchContext* ctx) {
+    Distribution* d = ctx->dist;
+
+    for (int i = 0; i < d->count; i++) {
+        Boid* b = d->flock[i];
+        ctx->triangles[i].v0 = (BoidVec2){b->positions[0].x + b->origin.x, b->positions[0].y + b->origin.y};
+        ctx->triangles[i].v1 = (BoidVec2){b->positions[1].x + b->origin.x, b->positions[1].y + b->origin.y};
+        ctx->triangles[i].v2 = (BoidVec2){b->positions[2].x + b->origin.x, b->positions[2].y + b->origin.y};
+    }
+}
+
+static void runVertexParallel(BenchContext* ctx) {
+    Distribution* d = ctx->dist;
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < d->count; i++) {
+        Boid* b = d->flock[i];
+        ctx->triangles[i].v0 = (BoidVec2){b->positions[0].x + b->origin.x, b->positions[0].y + b->origin.y};
+        ctx->triangles[i].v1 = (BoidVec2){b->positions[1].x + b->origin.x, b->positions[1].y + b->origin.y};
+        ctx->triangles[i].v2 = (BoidVec2){b->positions[2].x + b->origin.x, b->positions[2].y + b->origin.y};
+    }
+}
+
+static void runSinCosLibm(BenchContext* ctx) {
+    for (int i = 0; i < ctx->dist->count; i++) {
+        ctx->out0[i] = sinf(ctx->headings[i]);
+        ctx->out1[i] = cosf(ctx->headings[i]);
+    }
+}
+
+static void runSinCosBlock(BenchContext* ctx) {
+    sinCosBlock(ctx->headings, ctx->out0, ctx->out1, ctx->dist->count);
+}
+
+static void runAtan2Libm(BenchContext* ctx) {
+    for (int i = 0; i < ctx->dist->count; i++)
+        ctx->out0[i] = atan2f(ctx->dy[i], ctx->dx[i]);
+}
+
+static void runAtan2Block(BenchContext* ctx) {
+    atan2Block(ctx->dy, ctx->dx, ctx->out0, ctx->dist->count);
+}
+
+// one 1/FPS step of a column flock, from the same state every run
+static void stepFlock(BenchContext* ctx, Flock* flock, int synchronous, int symmetric, int tile) {
+    int n = flock->count;
+
+    memcpy(flock->x, ctx->start, n * sizeof(float));
+    memcpy(flock->y, ctx->start + n, n * sizeof(float));
+    memcpy(flock->rotation, ctx->start + 2 * n, n * sizeof(float));
+
+    flock->synchronous = synchronous;
+    flock->symmetric = symmetric;
+    flock->tileCells = tile;
+    flock->lastUpdate = 0;
+    updateFlock(flock, 1.0 / FPS);
+}
+
+static void runFlockSynchronous(BenchContext* ctx) {
+    stepFlock(ctx, &ctx->flock, 1, 0, 0);
+}
+
+static void runFlockTiled(BenchContext* ctx) {
+    stepFlock(ctx, &ctx->flock, 1, 0, tileCells);
+}
+
+static void runFlockSymmetric(BenchContext* ctx) {
+    stepFlock(ctx, &ctx->flock, 1, 1, 0);
+}
+
+static void runFlockSpecies(BenchContext* ctx) {
+    stepFlock(ctx, &ctx->mixed, 1, 0, 0);
+}
+
+static const Kernel kernels[] = {
+    {"getLocalFlock", "brute force", runLocalFlockBrute, opsQueries},
+    {"getLocalFlock", "grid", runLocalFlockGrid, opsQueries, prepareGrid},
+    {"getSeparation", "scalar", runSeparation, opsQueries},
+    {"rotateBoid", "scalar", runRotate, opsBoids},
+    {"vertex compute", "scalar", runVertexScalar, opsBoids},
+    {"vertex compute", "omp", runVertexParallel, opsBoids},
+    {"sincos", "libm", runSinCosLibm, opsBoids},
+    {"sincos", "fast block", runSinCosBlock, opsBoids},
+    {"atan2", "libm", runAtan2Libm, opsBoids},
+    {"atan2", "fast block", runAtan2Block, opsBoids},
+    {"flock step", "synchronous", runFlockSynchronous, opsBoids},
+    {"flock step", "tiled", runFlockTiled, opsBoids},
+    {"flock step", "symmetric", runFlockSymmetric, opsBoids},
+    {"flock step", "2 species", runFlockSpecies, opsBoids},
+};
+
+// harness
+
+static void measure(const Kernel* kernel, BenchContext* ctx) {
+    double ns[REPETITIONS], cycles[REPETITIONS];
+    long ops = kernel->ops(ctx);
+
+    for (int i = 0; i < WARMUP; i++) {
+        if (kernel->prepare)
+            kernel->prepare(ctx);
+        kernel->run(ctx);
+    }
+
+    for (int i = 0; i < REPETITIONS; i++) {
+        if (kernel->prepare)
+            kernel->prepare(ctx);
+
+        double t0 = nowNs();
+        unsigned long long c0 = nowCycles();
+        kernel->run(ctx);
+        unsigned long long c1 = nowCycles();
+        double t1 = nowNs();
+
+        ns[i] = (t1 - t0) / ops;
+        cycles[i] = (double)(c1 - c0) / ops;
+    }
+
+    qsort(ns, REPETITIONS, sizeof(double), compareDouble);
+    qsort(cycles, REPETITIONS, sizeof(double), compareDouble);
+
+    printf("%-15s | %-12s | %-8s | %10.2f | %10.2f | %11.1f | %11.1f\n",
+           kernel->name, kernel->variant, ctx->dist->name,
+           ns[0], ns[REPETITIONS / 2], cycles[0], cycles[REPETITIONS / 2]);
+}
+
+int main(int argc, char* argv[]) {
+    int count = 5000;
+    const char* filter = NULL;
+
+    if (argc > 1)
+        count = atoi(argv[1]);
+    if (argc > 2)
+        filter = argv[2];
+    if (argc > 3)
+        tileCells = atoi(argv[3]);
+
+    if (count < 1 || tileCells < 1) {
+        fprintf(stderr, "usage: %s [boids] [kernel name filter] [tile cells]\n", argv[0]);
+        return 1;
+    }
+
+    const char* kinds[] = {"uniform", "cluster", "ring"};
+    int kernelCount = sizeof(kernels) / sizeof(kernels[0]);
+
+    printf("Boids: %d, warmup %d, repetitions %d\n", count, WARMUP, REPETITIONS);
+    printf("Tile: %dx%d grid cells of one neighbor radius\n", tileCells, tileCells);
+    printf("%-15s | %-12s | %-8s | %10s | %10s | %11s | %11s\n",
+           "Kernel", "Variant", "Flock", "min ns/op", "med ns/op", "min cyc/op", "med cyc/op");
+
+    for (int k = 0; k < 3; k++) {
+        Distribution dist = {kinds[k], makeFlock(kinds[k], count), count};
+        BenchContext ctx = {&dist, malloc(sizeof(LocalFlock) * QUERIES), malloc(sizeof(Triangle) * count),
+                            malloc(sizeof(float) * count), malloc(sizeof(float) * count), malloc(sizeof(float) * count),
+                            malloc(sizeof(float) * count), malloc(sizeof(float) * count), 0, {0}, {0}, NULL};
+
+        // headings of the flock, and directions from the world center
+        for (int i = 0; i < count; i++) {
+            ctx.headings[i] = dist.flock[i]->rotation;
+            ctx.dx[i] = dist.flock[i]->origin.x - WIDTH / 2;
+            ctx.dy[i] = dist.flock[i]->origin.y - HEIGHT / 2;
+        }
+
+        for (int q = 0; q < QUERIES; q++)
+            ctx.localFlocks[q] = getLocalFlock(dist.flock[queryIndex(&ctx, q)], dist.flock, count);
+
+        flockCreate(&ctx.flock, count, WIDTH, HEIGHT);
+        flockCreate(&ctx.mixed, count, WIDTH, HEIGHT);
+        ctx.start = malloc(3 * sizeof(float) * count);
+        for (int i = 0; i < count; i++) {
+            Boid* b = dist.flock[i];
+            flockSetBoid(&ctx.flock, i, b->origin.x, b->origin.y, b->rotation, b->velocity.x, b->velocity.y, b->angularVelocity);
+            flockSetBoid(&ctx.mixed, i, b->origin.x, b->origin.y, b->rotation, b->velocity.x, b->velocity.y, b->angularVelocity);
+            ctx.start[i] = ctx.flock.x[i];
+            ctx.start[count + i] = ctx.flock.y[i];
+            ctx.start[2 * count + i] = ctx.flock.rotation[i];
+        }
+
+        gridInit(&ctx.grid, WIDTH, HEIGHT, NEIGHBOR_RADIUS, count, GRID_AUTO);
+
+        Species species[2] = {SPECIES_DEFAULT, SPECIES_PREDATOR};
+        int counts[2] = {count - count * PREDATORS / 100, count * PREDATORS / 100};
+        species[0].interaction[1] = SPECIES_AVOID;
+        flockSetSpecies(&ctx.mixed, species, counts, 2);
+
+        for (int i = 0; i < kernelCount; i++)
+            if (!filter || strstr(kernels[i].name, filter))
+                measure(&kernels[i], &ctx);
+
+        free(ctx.localFlocks);
+        free(ctx.triangles);
+        free(ctx.headings);
+        free(ctx.dx);
+        free(ctx.dy);
+        free(ctx.out0);
+        free(ctx.out1);
+        free(ctx.start);
+        gridFree(&ctx.grid);
+        flockDestroy(&ctx.flock);
+        flockDestroy(&ctx.mixed);
+        freeFlock(dist.flock, count);
+    }
+
+    return 0;
+}
@@ -0,0 +1,346 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "boids.h"
+#include "config.h"
+
+// Headless strong/weak scaling sweep of updateAllBoids.
+//
+// Every (boids, threads) point is stepped with a fixed 1/FPS clock and
+// repeated until the 95% confidence interval of the mean step time is
+// within --ci of the mean (or --max-reps / --max-seconds is hit).
+// Results go to a CSV and a JSON file so they can be tracked over releases.
+
+#define MAX_POINTS 64
+
+typedef struct Options {
+    int threads[MAX_POINTS];
+    int threadCount;
+    int boids[MAX_POINTS];
+    int boidCount;
+    int weakBase; // boids per thread for weak scaling, 0 disables
+    int warmup;
+    int minReps;
+    int maxReps;
+    double ci; // target relative CI half width
+    double maxSeconds; // per point budget
+    const char* csvPath;
+    const char* jsonPath;
+} Options;
+
+typedef struct Sample {
+    const char* mode; // "strong" or "weak"
+    int boids;
+    int threads;
+    int reps;
+    double mean; // ms per step
+    double stddev;
+    double ci95;
+    double min;
+    double speedup;
+    double efficiency;
+    int converged;
+    int skipped;
+} Sample;
+
+static Sample samples[2 * MAX_POINTS * MAX_POINTS];
+static int sampleCount;
+
+// two sided 95% Student t quantiles, df 1..30
+static const double tTable[30] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+static double tQuantile(int df) {
+    if (df < 1)
+        return INFINITY;
+    return df <= 30 ? tTable[df - 1] : 1.96;
+}
+
+static int parseList(const char* text, int* out) {
+    int count = 0;
+    char* copy = strdup(text);
+
+    for (char* tok = strtok(copy, ","); tok && count < MAX_POINTS; tok = strtok(NULL, ",")) {
+        int value = atoi(tok);
+        if (value > 0)
+            out[count++] = value;
+    }
+
+    free(copy);
+    return count;
+}
+
+// deterministic LCG so runs are comparable without raylib's RNG
+static unsigned int benchSeed = 42690;
+
+static float benchRandom(float max) {
+    benchSeed = benchSeed * 1664525u + 1013904223u;
+    return (benchSeed >> 8) * (1.0f / 16777216.0f) * max;
+}
+
+static Boid** createFlock(int count) {
+    Boid** flock = malloc(sizeof(Boid*) * count);
+
+    benchSeed = 42690;
+    for (int i = 0; i < count; i++) {
+        flock[i] = newBoid((BoidVec2){benchRandom(WIDTH), benchRandom(HEIGHT)}, (BoidVec2){20, 20}, (int)benchRandom(6), 1);
+        flock[i]->lastUpdate = 0.0;
+    }
+
+    return flock;
+}
+
+static void freeFlock(Boid** flock, int count) {
+    for (int i = 0; i < count; i++) {
+        free(flock[i]->positions);
+        free(flock[i]);
+    }
+    free(flock);
+}
+
+static Sample measure(const Options* opt, const char* mode, int boids, int threads) {
+    Sample s = {mode, boids, threads, 0, 0, 0, 0, INFINITY, 0, 0, 0, 0};
+    Boid** flock = createFlock(boids);
+    double dt = 1.0 / FPS;
+    double now = 0.0;
+    double sum = 0.0, sumSq = 0.0;
+
+    omp_set_num_threads(threads);
+
+    for (int i = 0; i < opt->warmup; i++) {
+        now += dt;
+        stepAllBoids(flock, boids, now);
+    }
+
+    double pointStart = omp_get_wtime();
+
+    while (s.reps < opt->maxReps) {
+        now += dt;
+        double t0 = omp_get_wtime();
+        stepAllBoids(flock, boids, now);
+        double step = (omp_get_wtime() - t0) * 1000.0;
+
+        s.reps++;
+        sum += step;
+        sumSq += step * step;
+        if (step < s.min)
+            s.min = step;
+
+        s.mean = sum / s.reps;
+        s.stddev = s.reps > 1 ? sqrt(fmax(0.0, (sumSq - sum * sum / s.reps) / (s.reps - 1))) : 0.0;
+        s.ci95 = tQuantile(s.reps - 1) * s.stddev / sqrt(s.reps);
+
+        if (s.reps >= opt->minReps && s.ci95 <= opt->ci * s.mean) {
+            s.converged = 1;
+            break;
+        }
+
+        if (omp_get_wtime() - pointStart > opt->maxSeconds)
+            break;
+    }
+
+    freeFlock(flock, boids);
+    return s;
+}
+
+// the neighbor search is brute force, so cost grows with boids squared
+static int tooExpensive(const Options* opt, const Sample* prev, int boids) {
+    if (!prev || prev->skipped)
+        return prev != NULL;
+
+    double ratio = (double)boids / prev->boids;
+    double estimate = prev->min * ratio * ratio / 1000.0;
+    return estimate * (opt->warmup + opt->minReps) > opt->maxSeconds;
+}
+
+// base is the series' first thread count, isBase marks that point itself
+static void runPoint(const Options* opt, const char* mode, int boids, int threads, const Sample* prev, const Sample* base, int isBase) {
+    Sample s;
+
+    if (tooExpensive(opt, prev, boids)) {
+        s = (Sample){mode, boids, threads, 0, 0, 0, 0, 0, 0, 0, 0, 1};
+    } else {
+        s = measure(opt, mode, boids, threads);
+        const Sample* ref = isBase ? &s : base;
+
+        // without a measured base the ratios are unknown and stay 0
+        if (ref && !strcmp(mode, "strong")) {
+            s.speedup = ref->mean / s.mean;
+            s.efficiency = s.speedup * ref->threads / threads;
+        } else if (ref) {
+            // weak scaling keeps boids per thread constant, ideal time is flat
+            s.speedup = ref->mean / s.mean * threads / ref->threads;
+            s.efficiency = ref->mean / s.mean;
+        }
+    }
+
+    samples[sampleCount++] = s;
+
+    if (s.skipped)
+        printf("%-6s | %8d | %7d | skipped, over the %.0f s budget\n", mode, boids, threads, opt->maxSeconds);
+    else
+        printf("%-6s | %8d | %7d | %10.3f | %8.3f | %4d%s | %6.2fx | %9.1f%%\n",
+               mode, boids, threads, s.mean, s.ci95, s.reps, s.converged ? " " : "*",
+               s.speedup, s.efficiency * 100.0);
+    fflush(stdout);
+}
+
+static void writeCsv(const char* path) {
+    FILE* fp = fopen(path, "w");
+    if (!fp) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return;
+    }
+
+    fprintf(fp, "mode,boids,threads,reps,mean_ms,stddev_ms,ci95_ms,min_ms,speedup,efficiency,converged,skipped\n");
+    for (int i = 0; i < sampleCount; i++) {
+        Sample* s = &samples[i];
+        fprintf(fp, "%s,%d,%d,%d,%.6f,%.6f,%.6f,%.6f,%.4f,%.4f,%d,%d\n",
+                s->mode, s->boids, s->threads, s->reps, s->mean, s->stddev, s->ci95,
+                s->skipped ? 0.0 : s->min, s->speedup, s->efficiency, s->converged, s->skipped);
+    }
+
+    fclose(fp);
+}
+
+static void writeJson(const char* path, const Options* opt) {
+    FILE* fp = fopen(path, "w");
+    if (!fp) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return;
+    }
+
+    fprintf(fp, "{\n  \"benchmark\": \"updateAllBoids\",\n");
+    fprintf(fp, "  \"compiler\": \"%s\",\n", __VERSION__);
+    fprintf(fp, "  \"procs\": %d,\n", omp_get_num_procs());
+    fprintf(fp, "  \"world\": [%d, %d],\n", WIDTH, HEIGHT);
+    fprintf(fp, "  \"dt\": %.6f,\n", 1.0 / FPS);
+    fprintf(fp, "  \"ci_target\": %.4f,\n", opt->ci);
+    fprintf(fp, "  \"results\": [\n");
+
+    for (int i = 0; i < sampleCount; i++) {
+        Sample* s = &samples[i];
+        fprintf(fp, "    {\"mode\": \"%s\", \"boids\": %d, \"threads\": %d, \"reps\": %d, "
+                    "\"mean_ms\": %.6f, \"stddev_ms\": %.6f, \"ci95_ms\": %.6f, \"min_ms\": %.6f, "
+                    "\"speedup\": %.4f, \"efficiency\": %.4f, \"converged\": %s, \"skipped\": %s}%s\n",
+                s->mode, s->boids, s->threads, s->reps, s->mean, s->stddev, s->ci95,
+                s->skipped ? 0.0 : s->min, s->speedup, s->efficiency,
+                s->converged ? "true" : "false", s->skipped ? "true" : "false",
+                i + 1 < sampleCount ? "," : "");
+    }
+
+    fprintf(fp, "  ]\n}\n");
+    fclose(fp);
+}
+
+static void usage(const char* name) {
+    printf("usage: %s [options]\n", name);
+    printf("  --threads LIST     thread counts, default 1..nproc\n");
+    printf("  --boids LIST       boid counts for strong scaling, default 1000,4000,16000,64000,256000,1000000\n");
+    printf("  --weak N           boids per thread for weak scaling, 0 to disable (default 1000)\n");
+    printf("  --warmup N         untimed steps per point (default 3)\n");
+    printf("  --min-reps N       minimum timed steps per point (default 10)\n");
+    printf("  --max-reps N       maximum timed steps per point (default 200)\n");
+    printf("  --ci F             target 95%% CI half width relative to the mean (default 0.02)\n");
+    printf("  --max-seconds F    time budget per point (default 30)\n");
+    printf("  --csv PATH         CSV output (default scaling.csv)\n");
+    printf("  --json PATH        JSON output (default scaling.json)\n");
+}
+
+int main(int argc, char* argv[]) {
+    Options opt = {0};
+    opt.boidCount = parseList("1000,4000,16000,64000,256000,1000000", opt.boids);
+    opt.weakBase = 1000;
+    opt.warmup = 3;
+    opt.minReps = 10;
+    opt.maxReps = 200;
+    opt.ci = 0.02;
+    opt.maxSeconds = 30.0;
+    opt.csvPath = "scaling.csv";
+    opt.jsonPath = "scaling.json";
+
+    int procs = omp_get_num_procs();
+    for (int t = 1; t <= procs && t <= MAX_POINTS; t++)
+        opt.threads[opt.threadCount++] = t;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (!strcmp(arg, "--help") || !strcmp(arg, "-h")) {
+            usage(argv[0]);
+            return 0;
+        }
+
+        if (!value) {
+            fprintf(stderr, "missing value for %s\n", arg);
+            return 1;
+        }
+
+        if (!strcmp(arg, "--threads")) opt.threadCount = parseList(value, opt.threads);
+        else if (!strcmp(arg, "--boids")) opt.boidCount = parseList(value, opt.boids);
+        else if (!strcmp(arg, "--weak")) opt.weakBase = atoi(value);
+        else if (!strcmp(arg, "--warmup")) opt.warmup = atoi(value);
+        else if (!strcmp(arg, "--min-reps")) opt.minReps = atoi(value);
+        else if (!strcmp(arg, "--max-reps")) opt.maxReps = atoi(value);
+        else if (!strcmp(arg, "--ci")) opt.ci = atof(value);
+        else if (!strcmp(arg, "--max-seconds")) opt.maxSeconds = atof(value);
+        else if (!strcmp(arg, "--csv")) opt.csvPath = value;
+        else if (!strcmp(arg, "--json")) opt.jsonPath = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", arg);
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    if (!opt.threadCount || !opt.boidCount || opt.minReps < 2 || opt.maxReps < opt.minReps) {
+        fprintf(stderr, "invalid options\n");
+        return 1;
+    }
+
+    printf("Mode   |    Boids | Threads |  Step (ms) | CI95 (ms) | Reps | Speedup | Efficiency\n");
+
+    // strong scaling: fixed problem, more threads
+    for (int b = 0; b < opt.boidCount; b++) {
+        int first = sampleCount;
+
+        for (int t = 0; t < opt.threadCount; t++) {
+            // compare against the previous boid count at the same thread count
+            const Sample* prev = NULL;
+            for (int i = first - 1; i >= 0; i--)
+                if (samples[i].threads == opt.threads[t]) {
+                    prev = &samples[i];
+                    break;
+                }
+
+            const Sample* base = sampleCount > first && !samples[first].skipped ? &samples[first] : NULL;
+            runPoint(&opt, "strong", opt.boids[b], opt.threads[t], prev, base, t == 0);
+        }
+    }
+
+    // weak scaling: fixed boids per thread
+    if (opt.weakBase > 0) {
+        int first = sampleCount;
+
+        for (int t = 0; t < opt.threadCount; t++) {
+            const Sample* prev = sampleCount > first ? &samples[sampleCount - 1] : NULL;
+            const Sample* base = sampleCount > first && !samples[first].skipped ? &samples[first] : NULL;
+            runPoint(&opt, "weak", opt.weakBase * opt.threads[t], opt.threads[t], prev, base, t == 0);
+        }
+    }
+
+    printf("(* = CI target not reached within the rep/time budget)\n");
+
+    writeCsv(opt.csvPath);
+    writeJson(opt.jsonPath, &opt);
+    printf("Results saved to %s and %s\n", opt.csvPath, opt.jsonPath);
+
+    return 0;
+}
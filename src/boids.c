@@ -1,37 +1,44 @@
 #include <stdlib.h>
 #include <math.h>
-#include <raylib.h>
+#include <time.h>
+#include <omp.h>
 
 #include "boids.h"
+#include "boids_kernels.h"
+#include "fastmath.h"
+#include "trace.h"
 
 #define MODULO(a, n) fmod((a), (n)) + (((a) < 0) * (n))
 #define INVERSE(theta) fmod((theta)+M_PI, 2*M_PI)
-#define localFlockSize 128
-#define WIDTH 1920
-#define HEIGHT 1200
 
-struct LocalFlock {
-     Boid* flock[localFlockSize];
-     int size;
-} typedef LocalFlock;
+double boidClock(void) {
+     struct timespec ts;
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
 
-Boid* newBoid(Vector2 origin, Vector2 velocity, float rotation, float angularVelocity) {
-     Vector2* positions = malloc(sizeof(Vector2)*3);
+Boid* newBoid(BoidVec2 origin, BoidVec2 velocity, float rotation, float angularVelocity) {
+     BoidVec2* positions = malloc(sizeof(BoidVec2)*3);
+     Boid* boid = malloc(sizeof(Boid));
+     if (!positions || !boid) {
+          free(positions);
+          free(boid);
+          return NULL;
+     }
 
-     positions[0] = (Vector2){0.0f, -5.0f};
-     positions[1] = (Vector2){-5, 5};
-     positions[2] = (Vector2){5, 5};
+     positions[0] = (BoidVec2){0.0f, -5.0f};
+     positions[1] = (BoidVec2){-5, 5};
+     positions[2] = (BoidVec2){5, 5};
 
-     Boid* boid = malloc(sizeof(Boid));
-     *boid = (Boid){origin, 0, positions, velocity, angularVelocity, GetTime()};
+     *boid = (Boid){origin, 0, positions, velocity, angularVelocity, boidClock()};
 
      rotateBoid(boid, rotation);
 
      return boid;
 }
 
-float distance(Vector2 v1, Vector2 v2) {
-     Vector2 delta = {fabsf(v1.x - v2.x), fabsf(v1.y - v2.y)};
+float distance(BoidVec2 v1, BoidVec2 v2) {
+     BoidVec2 delta = {fabsf(v1.x - v2.x), fabsf(v1.y - v2.y)};
      return sqrtf(delta.x*delta.x+delta.y*delta.y);
 }
 
@@ -45,7 +52,7 @@ LocalFlock getLocalFlock(Boid* boid, Boid** flock, int flockSize) {
                localFlock.flock[localFlock.size] = flock[i];
                localFlock.size += 1;
 
-               if (localFlock.size > localFlockSize)
+               if (localFlock.size == localFlockSize)
                     break;
           }
      }
@@ -53,23 +60,23 @@ LocalFlock getLocalFlock(Boid* boid, Boid** flock, int flockSize) {
      return localFlock;
 }
 
-float getRotation(Vector2 v1, Vector2 v2) {
-     Vector2 delta = {v1.x - v2.x, v1.y - v2.y};
-     return atan2f(-delta.x, delta.y);
+float getRotation(BoidVec2 v1, BoidVec2 v2) {
+     BoidVec2 delta = {v1.x - v2.x, v1.y - v2.y};
+     return fastAtan2(-delta.x, delta.y);
 }
 
 float getCohesion(Boid* boid, LocalFlock localFlock) {
      if (!localFlock.size)
           return boid->rotation;
 
-     Vector2 mean = {0, 0};
+     BoidVec2 mean = {0, 0};
 
      for (int i = 0; i < localFlock.size; i++) {
           mean.x += localFlock.flock[i]->origin.x;
           mean.y += localFlock.flock[i]->origin.y;
      }
 
-     mean = (Vector2){mean.x/localFlock.size, mean.y/localFlock.size};
+     mean = (BoidVec2){mean.x/localFlock.size, mean.y/localFlock.size};
      return getRotation(boid->origin, mean);
 }
 
@@ -107,22 +114,24 @@ float getSeparation(Boid* boid, LocalFlock localFlock) {
      return INVERSE(closestLocalRotation);
 }
 
-void updateBoid(Boid* boid, Boid** flock, int flockSize) {
-     double now = GetTime();
+// one boid, in place, wrapping at width x height
+static void stepOne(Boid* boid, Boid** flock, int flockSize, double now, float width, float height) {
      double deltaTime = now - boid->lastUpdate;
 
+     TRACE_BEGIN("neighbor search");
      LocalFlock localFlock = getLocalFlock(boid, flock, flockSize);
+     TRACE_END("neighbor search");
 
+     TRACE_BEGIN("rules");
      float closestBoid = -1;
-     for (int i = 0; i < localFlock.size; i++) {
-          float dist = distance(boid->origin, localFlock.flock[i]->origin);
+     for (int j = 0; j < localFlock.size; j++) {
+          float dist = distance(boid->origin, localFlock.flock[j]->origin);
 
-          if (distance(boid->origin, localFlock.flock[i]->origin) < closestBoid || closestBoid == -1)
+          if (dist < closestBoid || closestBoid == -1)
                closestBoid = dist;
      }
 
      // Rotation Updates
-
      float alignment = getAlignment(boid, localFlock);
      float cohesion = getCohesion(boid, localFlock);
      float separation = getSeparation(boid, localFlock);
@@ -148,37 +157,74 @@ void updateBoid(Boid* boid, Boid** flock, int flockSize) {
 
      if (targetRotation < -maximumRotation)
           targetRotation = -maximumRotation;
+     TRACE_END("rules");
 
+     TRACE_BEGIN("integration");
      rotateBoid(boid, targetRotation);
 
      // Position Updates
-
-     Vector2 velocity = {sinf(boid->rotation)*boid->velocity.x, -cosf(boid->rotation)*boid->velocity.y};
-     boid->origin = (Vector2){boid->origin.x + velocity.x * deltaTime, boid->origin.y + velocity.y * deltaTime};
-     boid->origin = (Vector2){MODULO(boid->origin.x, WIDTH), MODULO(boid->origin.y, HEIGHT)};
+     BoidVec2 velocity = {fastSin(boid->rotation)*boid->velocity.x, -fastCos(boid->rotation)*boid->velocity.y};
+     boid->origin = (BoidVec2){boid->origin.x + velocity.x * deltaTime, boid->origin.y + velocity.y * deltaTime};
+     boid->origin = (BoidVec2){MODULO(boid->origin.x, width), MODULO(boid->origin.y, height)};
 
      boid->lastUpdate = now;
+     TRACE_END("integration");
+}
+
+void updateBoid(Boid* boid, Boid** flock, int flockSize) {
+     stepBoid(boid, flock, flockSize, boidClock());
+}
+
+void stepBoid(Boid* boid, Boid** flock, int flockSize, double now) {
+     stepOne(boid, flock, flockSize, now, BOIDS_WIDTH, BOIDS_HEIGHT);
+}
+
+// New function to update all boids in parallel
+void updateAllBoids(Boid** flock, int flockSize) {
+     stepAllBoids(flock, flockSize, boidClock());
+}
+
+// Same as updateAllBoids but driven by the caller's clock, used headless
+void stepAllBoids(Boid** flock, int flockSize, double now) {
+     stepBoidSlice(flock, flockSize, now, 0, 1);
+}
+
+void stepBoidSlice(Boid** flock, int flockSize, double now, int slice, int slices) {
+     stepBoidsWith(flock, flockSize, now, slice, slices, BOID_STEPPER_PARALLEL, BOIDS_WIDTH, BOIDS_HEIGHT);
+}
+
+// Steps boids slice, slice + slices, ... only. Each boid keeps its own
+// lastUpdate, so a boid stepped every slices frames gets that much dt.
+// The serial stepper runs the same loop on the calling thread, in index
+// order, like the original single threaded update.
+void stepBoidsWith(Boid** flock, int flockSize, double now, int slice, int slices, BoidStepper stepper, float width, float height) {
+     #pragma omp parallel if (stepper == BOID_STEPPER_PARALLEL)
+     {
+          TRACE_BEGIN("boids");
+
+          #pragma omp for schedule(dynamic) nowait
+          for (int i = slice; i < flockSize; i += slices)
+               stepOne(flock[i], flock, flockSize, now, width, height);
+
+          TRACE_END("boids");
+
+          // explicit so idle time at the barrier shows up in traces
+          TRACE_BEGIN("barrier");
+          #pragma omp barrier
+          TRACE_END("barrier");
+     }
 }
 
 void rotateBoid(Boid* boid, float theta) {
      float rotationDelta = boid->rotation + theta;
+     float s = fastSin(theta), c = fastCos(theta);
 
      for (int i = 0; i < 3; i++) {
           float x = boid->positions[i].x;
           float y = boid->positions[i].y;
-          boid->positions[i].x = cos(theta) * x - sin(theta) * y;
-          boid->positions[i].y = sin(theta) * x + cos(theta) * y;
+          boid->positions[i].x = c * x - s * y;
+          boid->positions[i].y = s * x + c * y;
      }
 
      boid->rotation = fmod(rotationDelta, 2*M_PI);
 }
-
-void drawBoid(Boid* boid) {
-     Vector2 screenPositions[3] = {boid->positions[0], boid->positions[1], boid->positions[2]};
-
-     for (int i = 0; i < 3; i++) {
-          screenPositions[i] = (Vector2){screenPositions[i].x+boid->origin.x, screenPositions[i].y+boid->origin.y};
-     }
-
-     DrawTriangle(screenPositions[0], screenPositions[1], screenPositions[2], BLUE);
-}
\ No newline at end of file
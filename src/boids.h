@@ -1,17 +1,42 @@
 #pragma once
-#include <raylib.h>
+
+// Boids as individual heap objects, the original representation, stepped
+// in place. Plain types only, no raylib or GL: this is part of
+// libboidsim.a, and front-ends convert to raylib's Vector2 when drawing.
+// For embedding, boidsim.h wraps it behind a stable API.
+
+// same layout as raylib's Vector2
+typedef struct BoidVec2 {
+    float x;
+    float y;
+} BoidVec2;
 
 typedef struct Boid {
-    Vector2 origin;
+    BoidVec2 origin;
     float rotation;
-    Vector2* positions;
-    Vector2 velocity; // pixels per second
+    BoidVec2* positions;
+    BoidVec2 velocity; // pixels per second
     float angularVelocity; // radians per second
     double lastUpdate;
 } Boid;
 
-Boid* newBoid(Vector2 origin, Vector2 velocity, float rotation, float angularVelocity);
+// how a whole flock is stepped, chosen at run time
+typedef enum BoidStepper {
+    BOID_STEPPER_SERIAL, // calling thread, index order
+    BOID_STEPPER_PARALLEL, // OpenMP team
+} BoidStepper;
+
+// world the calls without an explicit size wrap in
+#define BOIDS_WIDTH 1920
+#define BOIDS_HEIGHT 1200
+
+double boidClock(void); // monotonic seconds, read by newBoid and the update* calls
+
+Boid* newBoid(BoidVec2 origin, BoidVec2 velocity, float rotation, float angularVelocity); // NULL when out of memory
 void updateBoid(Boid* boid, Boid** flock, int flockSize);
+void stepBoid(Boid* boid, Boid** flock, int flockSize, double now); // updateBoid with an explicit clock
 void rotateBoid(Boid* boid, float theta);
-void drawBoid(Boid* boid);
-void updateAllBoids(Boid** flock, int flockSize);
\ No newline at end of file
+void updateAllBoids(Boid** flock, int flockSize);
+void stepAllBoids(Boid** flock, int flockSize, double now); // updateAllBoids with an explicit clock
+void stepBoidSlice(Boid** flock, int flockSize, double now, int slice, int slices); // stepAllBoids on every slices-th boid from slice
+void stepBoidsWith(Boid** flock, int flockSize, double now, int slice, int slices, BoidStepper stepper, float width, float height);
@@ -0,0 +1,19 @@
+#pragma once
+#include "boids.h"
+
+// Rule kernels of boids.c, exposed so they can be benchmarked in
+// isolation (bench_kernels.c).
+
+#define localFlockSize 128
+
+struct LocalFlock {
+     Boid* flock[localFlockSize];
+     int size;
+} typedef LocalFlock;
+
+float distance(BoidVec2 v1, BoidVec2 v2);
+LocalFlock getLocalFlock(Boid* boid, Boid** flock, int flockSize);
+float getRotation(BoidVec2 v1, BoidVec2 v2);
+float getCohesion(Boid* boid, LocalFlock localFlock);
+float getAlignment(Boid* boid, LocalFlock localFlock);
+float getSeparation(Boid* boid, LocalFlock localFlock);
@@ -0,0 +1,117 @@
+#include <stdlib.h>
+#include <math.h>
+
+#include "boidsim.h"
+#include "boids.h"
+
+struct BoidSim {
+    int count;
+    float width;
+    float height;
+    BoidSimStepper stepper;
+    double time;
+    Boid** boids;
+};
+
+// triangle template, same as newBoid
+static const BoidVec2 shape[3] = {{0.0f, -5.0f}, {-5.0f, 5.0f}, {5.0f, 5.0f}};
+
+int boidsimApiVersion(void) {
+    return BOIDSIM_API_VERSION;
+}
+
+BoidSim* boidsimCreate(int count, float width, float height, BoidSimStepper stepper) {
+    if (count < 0 || !(width > 0) || !(height > 0))
+        return NULL;
+
+    BoidSim* sim = calloc(1, sizeof(BoidSim));
+    if (!sim)
+        return NULL;
+
+    sim->width = width;
+    sim->height = height;
+    sim->boids = calloc(count ? count : 1, sizeof(Boid*));
+    if (!sim->boids || boidsimSetStepper(sim, stepper)) {
+        boidsimDestroy(sim);
+        return NULL;
+    }
+
+    for (; sim->count < count; sim->count++) {
+        Boid* boid = newBoid((BoidVec2){0, 0}, (BoidVec2){0, 0}, 0, 0);
+        if (!boid) {
+            boidsimDestroy(sim);
+            return NULL;
+        }
+        boid->lastUpdate = 0;
+        sim->boids[sim->count] = boid;
+    }
+
+    return sim;
+}
+
+void boidsimDestroy(BoidSim* sim) {
+    if (!sim)
+        return;
+
+    for (int i = 0; i < sim->count; i++) {
+        free(sim->boids[i]->positions);
+        free(sim->boids[i]);
+    }
+    free(sim->boids);
+    free(sim);
+}
+
+int boidsimCount(const BoidSim* sim) {
+    return sim->count;
+}
+
+double boidsimTime(const BoidSim* sim) {
+    return sim->time;
+}
+
+int boidsimSetStepper(BoidSim* sim, BoidSimStepper stepper) {
+    if (stepper != BOIDSIM_SERIAL && stepper != BOIDSIM_PARALLEL)
+        return -1;
+
+    sim->stepper = stepper;
+    return 0;
+}
+
+int boidsimSetBoid(BoidSim* sim, int i, const BoidSimBoid* boid) {
+    if (i < 0 || i >= sim->count)
+        return -1;
+
+    Boid* b = sim->boids[i];
+    b->origin = (BoidVec2){boid->x, boid->y};
+    b->velocity = (BoidVec2){boid->speedX, boid->speedY};
+    b->angularVelocity = boid->angularVelocity;
+    b->lastUpdate = sim->time;
+
+    // rotated from the template, as newBoid does
+    for (int v = 0; v < 3; v++)
+        b->positions[v] = shape[v];
+    b->rotation = 0;
+    rotateBoid(b, boid->rotation);
+
+    return 0;
+}
+
+int boidsimGetBoid(const BoidSim* sim, int i, BoidSimBoid* boid) {
+    if (i < 0 || i >= sim->count)
+        return -1;
+
+    const Boid* b = sim->boids[i];
+    *boid = (BoidSimBoid){b->origin.x, b->origin.y, b->rotation, b->velocity.x, b->velocity.y, b->angularVelocity};
+    return 0;
+}
+
+int boidsimStep(BoidSim* sim, double dt) {
+    if (!(dt >= 0))
+        return -1;
+
+    BoidStepper stepper = sim->stepper == BOIDSIM_PARALLEL ? BOID_STEPPER_PARALLEL : BOID_STEPPER_SERIAL;
+
+    sim->time += dt;
+    stepBoidsWith(sim->boids, sim->count, sim->time, 0, 1, stepper, sim->width, sim->height);
+    return 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+// Stable C API of libboidsim.a, for embedding the simulation in programs
+// without raylib or GL.
+//
+// The simulation is opaque and boids go in and out as plain structs, so
+// the layout of the internals can change freely. This header only grows:
+// functions are added, never changed, and BOIDSIM_API_VERSION goes up when
+// they are. Boids follow the rules of boids.c, stepped in place by the
+// serial or the OpenMP stepper, which can be switched between steps.
+//
+// Calls that take an index or a stepper return -1 when it is invalid, 0
+// otherwise.
+#define BOIDSIM_API_VERSION 1
+
+typedef struct BoidSim BoidSim;
+
+typedef enum BoidSimStepper {
+    BOIDSIM_SERIAL = 0, // calling thread, boids in index order
+    BOIDSIM_PARALLEL = 1, // OpenMP team, OMP_NUM_THREADS threads
+} BoidSimStepper;
+
+typedef struct BoidSimBoid {
+    float x; // pixels, wraps to [0, width) x [0, height)
+    float y;
+    float rotation; // radians, 0 points up
+    float speedX; // pixels per second
+    float speedY;
+    float angularVelocity; // radians per second
+} BoidSimBoid;
+
+int boidsimApiVersion(void); // of the library linked, compare with BOIDSIM_API_VERSION
+
+// count boids at rest at (0, 0), to be placed with boidsimSetBoid. NULL
+// for a negative count or an empty world, or without memory.
+BoidSim* boidsimCreate(int count, float width, float height, BoidSimStepper stepper);
+void boidsimDestroy(BoidSim* sim);
+
+int boidsimCount(const BoidSim* sim);
+double boidsimTime(const BoidSim* sim); // seconds simulated so far
+int boidsimSetStepper(BoidSim* sim, BoidSimStepper stepper);
+int boidsimSetBoid(BoidSim* sim, int i, const BoidSimBoid* boid);
+int boidsimGetBoid(const BoidSim* sim, int i, BoidSimBoid* boid);
+
+// advances every boid by dt seconds, -1 for a negative dt
+int boidsimStep(BoidSim* sim, double dt);
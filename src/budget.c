@@ -0,0 +1,109 @@
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+
+#include "budget.h"
+#include "trace.h"
+
+#define SMOOTHING 0.1 // weight of the newest step in the average
+#define SETTLE 10 // steps to measure a new level before judging it
+#define CALM 60 // steps under half the target before restoring a level
+
+static const char* names[BUDGET_LEVELS] = {"full", "capped", "capped16", "reused", "halved"};
+
+void budgetInit(Budget* b, double target) {
+    memset(b, 0, sizeof(*b));
+    b->target = target;
+}
+
+void budgetFree(Budget* b) {
+    free(b->steps);
+    memset(b, 0, sizeof(*b));
+}
+
+void budgetFocus(Budget* b, float x0, float y0, float x1, float y1) {
+    b->focus[0] = x0;
+    b->focus[1] = y0;
+    b->focus[2] = x1;
+    b->focus[3] = y1;
+    b->focused = 1;
+}
+
+const char* budgetLevelName(int level) {
+    return level >= 0 && level < BUDGET_LEVELS ? names[level] : "?";
+}
+
+// boids in focus step every frame, the rest take turns by index parity
+static const unsigned char* halvedSteps(Budget* b, const Flock* flock) {
+    if (b->stepsCount < flock->count) {
+        free(b->steps);
+        b->steps = malloc(flock->count);
+        b->stepsCount = b->steps ? flock->count : 0;
+        if (!b->steps)
+            return NULL;
+    }
+
+    unsigned char* steps = b->steps;
+    const float* f = b->focus;
+    int focused = b->focused;
+    int parity = b->frame & 1;
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < flock->count; i++) {
+        float x = flock->x[i], y = flock->y[i];
+        int inside = focused && x >= f[0] && x < f[2] && y >= f[1] && y < f[3];
+        steps[i] = inside ? 1 : ((i & 1) == parity) * 2;
+    }
+
+    return steps;
+}
+
+static void apply(const Budget* b, Flock* flock) {
+    flock->neighborCap = b->level >= BUDGET_CAPPED16 ? 16 : b->level >= BUDGET_CAPPED ? 32 : 0;
+    flock->reuseNeighbors = b->level >= BUDGET_REUSED;
+}
+
+static void judge(Budget* b, double seconds) {
+    b->average = b->average ? b->average + SMOOTHING * (seconds - b->average) : seconds;
+
+    if (b->hold > 0) {
+        b->hold--;
+        return;
+    }
+
+    int level = b->level;
+
+    if (b->average > b->target && level < BUDGET_LEVELS - 1) {
+        level++;
+    } else if (b->average < b->target / 2 && level > 0) {
+        if (++b->calm >= CALM)
+            level--;
+    } else {
+        b->calm = 0;
+    }
+
+    if (level != b->level) {
+        b->level = level;
+        b->average = 0;
+        b->hold = SETTLE;
+        b->calm = 0;
+    }
+}
+
+double budgetStep(Budget* b, Flock* flock, double now) {
+    double start = omp_get_wtime();
+
+    apply(b, flock);
+
+    TRACE_BEGIN("budget");
+    const unsigned char* steps = b->level >= BUDGET_HALVED ? halvedSteps(b, flock) : NULL;
+    TRACE_END("budget");
+
+    updateFlockActive(flock, now, steps);
+    b->frame++;
+
+    double seconds = omp_get_wtime() - start;
+    judge(b, seconds);
+
+    return seconds;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "flock.h"
+
+// Frame budget controller: times every step against a target, a share of
+// the 1/FPS frame, and trades flocking accuracy for time while it runs
+// over. Levels go down in order, each keeping the ones before it:
+//
+//   full      every neighbor up to 128
+//   capped    at most 32 neighbors per boid
+//   capped16  at most 16
+//   reused    neighbor lists kept across steps (Flock.reuseNeighbors)
+//   halved    boids outside the focus rectangle step every other frame,
+//             twice as far; with no focus set that is every boid
+//
+// Quality comes back one level at a time once the step has stayed under
+// half the target for a second, so it does not flap at the boundary.
+typedef enum BudgetLevel {
+    BUDGET_FULL,
+    BUDGET_CAPPED,
+    BUDGET_CAPPED16,
+    BUDGET_REUSED,
+    BUDGET_HALVED,
+    BUDGET_LEVELS
+} BudgetLevel;
+
+typedef struct Budget {
+    double target; // seconds a step may take
+    double average; // smoothed step time, 0 right after a level change
+    int level;
+    int hold; // steps before the level may change again
+    int calm; // consecutive steps with headroom
+    unsigned long frame;
+
+    float focus[4]; // x0, y0, x1, y1 in world space, usually the view
+    int focused;
+
+    unsigned char* steps; // per boid, for updateFlockActive
+    int stepsCount;
+} Budget;
+
+void budgetInit(Budget* b, double target);
+void budgetFree(Budget* b);
+void budgetFocus(Budget* b, float x0, float y0, float x1, float y1);
+double budgetStep(Budget* b, Flock* flock, double now); // steps at the current level, returns the seconds it took
+const char* budgetLevelName(int level);
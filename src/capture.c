@@ -0,0 +1,262 @@
+#define GL_GLEXT_PROTOTYPES
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <raylib.h>
+#include <rlgl.h>
+
+#include "capture.h"
+
+#define CAPTURE_PBOS 2
+#define CAPTURE_BUFFERS 3
+#define CAPTURE_CHANNELS 4
+
+struct Capture {
+    RenderTexture2D target;
+    int width;
+    int height;
+    size_t frameSize;
+    FILE* fp;
+    int piped;
+
+    // gpu side, render thread only
+    GLuint pbos[CAPTURE_PBOS];
+    GLsync fences[CAPTURE_PBOS];
+    unsigned long frames; // frames handed to readback
+    double waitTime;      // render thread blocked on the gpu or the writer
+
+    // host frames handed to the writer, a queue of `filled` slots from `head`
+    unsigned char* buffers[CAPTURE_BUFFERS];
+    int head;
+    int filled;
+    int closing;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    // writer thread only
+    unsigned long written;
+    int writeError;
+};
+
+static void* writerMain(void* arg) {
+    Capture* cap = arg;
+    size_t row = (size_t)cap->width * CAPTURE_CHANNELS;
+
+    for (;;) {
+        pthread_mutex_lock(&cap->lock);
+        while (!cap->filled && !cap->closing)
+            pthread_cond_wait(&cap->cond, &cap->lock);
+
+        if (!cap->filled) {
+            pthread_mutex_unlock(&cap->lock);
+            break;
+        }
+
+        int slot = cap->head;
+        pthread_mutex_unlock(&cap->lock);
+
+        // gl rows start at the bottom
+        const unsigned char* pixels = cap->buffers[slot];
+        for (int y = cap->height - 1; y >= 0 && !cap->writeError; y--)
+            if (fwrite(pixels + y * row, 1, row, cap->fp) != row)
+                cap->writeError = 1;
+        cap->written++;
+
+        pthread_mutex_lock(&cap->lock);
+        cap->head = (cap->head + 1) % CAPTURE_BUFFERS;
+        cap->filled--;
+        pthread_cond_broadcast(&cap->cond);
+        pthread_mutex_unlock(&cap->lock);
+    }
+
+    return NULL;
+}
+
+// map a finished readback and queue it, waiting for a free slot if needed
+static void collect(Capture* cap, int pbo) {
+    double t0 = GetTime();
+
+    glClientWaitSync(cap->fences[pbo], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(cap->fences[pbo]);
+    cap->fences[pbo] = 0;
+
+    pthread_mutex_lock(&cap->lock);
+    while (cap->filled == CAPTURE_BUFFERS)
+        pthread_cond_wait(&cap->cond, &cap->lock);
+    int slot = (cap->head + cap->filled) % CAPTURE_BUFFERS;
+    pthread_mutex_unlock(&cap->lock);
+
+    cap->waitTime += GetTime() - t0;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, cap->pbos[pbo]);
+    const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, cap->frameSize, GL_MAP_READ_BIT);
+    if (pixels) {
+        memcpy(cap->buffers[slot], pixels, cap->frameSize);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    } else
+        memset(cap->buffers[slot], 0, cap->frameSize);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    pthread_mutex_lock(&cap->lock);
+    cap->filled++;
+    pthread_cond_broadcast(&cap->cond);
+    pthread_mutex_unlock(&cap->lock);
+}
+
+// the real stdout once captureClaimStdout has moved text off it
+static FILE* claimedStdout;
+
+int captureClaimStdout(void) {
+    if (claimedStdout)
+        return 0;
+
+    fflush(stdout);
+    int fd = dup(STDOUT_FILENO);
+    if (fd < 0 || !(claimedStdout = fdopen(fd, "wb")) || dup2(STDERR_FILENO, STDOUT_FILENO) < 0) {
+        fprintf(stderr, "capture: cannot move text off stdout\n");
+        if (claimedStdout)
+            fclose(claimedStdout);
+        else if (fd >= 0)
+            close(fd);
+        claimedStdout = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+Capture* captureOpen(const char* output, int width, int height) {
+    if (rlGetVersion() < RL_OPENGL_33) {
+        fprintf(stderr, "capture: needs OpenGL 3.3\n");
+        return NULL;
+    }
+
+    Capture* cap = calloc(1, sizeof(Capture));
+    if (!cap)
+        return NULL;
+
+    cap->width = width;
+    cap->height = height;
+    cap->frameSize = (size_t)width * height * CAPTURE_CHANNELS;
+
+    if (!strcmp(output, "-"))
+        cap->fp = captureClaimStdout() == 0 ? claimedStdout : NULL;
+    else if (output[0] == '|') {
+        cap->fp = popen(output + 1, "w");
+        cap->piped = 1;
+    } else
+        cap->fp = fopen(output, "wb");
+
+    if (!cap->fp) {
+        fprintf(stderr, "capture: cannot open %s\n", output);
+        free(cap);
+        return NULL;
+    }
+
+    int ok = 1;
+    for (int i = 0; i < CAPTURE_BUFFERS; i++)
+        ok = ok && (cap->buffers[i] = malloc(cap->frameSize));
+
+    cap->target = LoadRenderTexture(width, height);
+    ok = ok && IsRenderTextureValid(cap->target);
+
+    glGenBuffers(CAPTURE_PBOS, cap->pbos);
+    for (int i = 0; i < CAPTURE_PBOS; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, cap->pbos[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, cap->frameSize, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    ok = ok && glGetError() == GL_NO_ERROR;
+
+    pthread_mutex_init(&cap->lock, NULL);
+    pthread_cond_init(&cap->cond, NULL);
+    ok = ok && pthread_create(&cap->thread, NULL, writerMain, cap) == 0;
+
+    if (!ok) {
+        fprintf(stderr, "capture: setup failed for %s\n", output);
+        glDeleteBuffers(CAPTURE_PBOS, cap->pbos);
+        if (IsRenderTextureValid(cap->target))
+            UnloadRenderTexture(cap->target);
+        for (int i = 0; i < CAPTURE_BUFFERS; i++)
+            free(cap->buffers[i]);
+        if (cap->piped)
+            pclose(cap->fp);
+        else
+            fclose(cap->fp);
+        if (cap->fp == claimedStdout)
+            claimedStdout = NULL;
+        pthread_mutex_destroy(&cap->lock);
+        pthread_cond_destroy(&cap->cond);
+        free(cap);
+        return NULL;
+    }
+
+    return cap;
+}
+
+void captureBegin(Capture* cap) {
+    BeginTextureMode(cap->target);
+}
+
+void captureEnd(Capture* cap) {
+    int pbo = cap->frames % CAPTURE_PBOS;
+
+    // flush the batch while the framebuffer is still bound, then start the
+    // copy into the pbo; glReadPixels returns without waiting for it
+    rlDrawRenderBatchActive();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, cap->pbos[pbo]);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, cap->width, cap->height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    cap->fences[pbo] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    EndTextureMode();
+
+    // the previous frame has had a whole frame to arrive
+    if (cap->frames > 0)
+        collect(cap, (cap->frames - 1) % CAPTURE_PBOS);
+    cap->frames++;
+}
+
+RenderTexture2D captureTarget(const Capture* cap) {
+    return cap->target;
+}
+
+void captureClose(Capture* cap) {
+    if (!cap)
+        return;
+
+    if (cap->frames > 0)
+        collect(cap, (cap->frames - 1) % CAPTURE_PBOS);
+
+    pthread_mutex_lock(&cap->lock);
+    cap->closing = 1;
+    pthread_cond_broadcast(&cap->cond);
+    pthread_mutex_unlock(&cap->lock);
+    pthread_join(cap->thread, NULL);
+
+    int ok = !cap->writeError;
+    if (cap->piped)
+        ok = pclose(cap->fp) == 0 && ok;
+    else
+        ok = fclose(cap->fp) == 0 && ok;
+    if (cap->fp == claimedStdout)
+        claimedStdout = NULL;
+
+    // stdout may have been the frame stream, report on stderr
+    fprintf(stderr, "Captured %lu frames %dx%d, %.1f MB, %.2f s blocked on readback or output%s\n",
+            cap->written, cap->width, cap->height, cap->written * (double)cap->frameSize / 1e6,
+            cap->waitTime, ok ? "" : ", WRITE FAILED");
+
+    glDeleteBuffers(CAPTURE_PBOS, cap->pbos);
+    UnloadRenderTexture(cap->target);
+    pthread_mutex_destroy(&cap->lock);
+    pthread_cond_destroy(&cap->cond);
+    for (int i = 0; i < CAPTURE_BUFFERS; i++)
+        free(cap->buffers[i]);
+    free(cap);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <raylib.h>
+
+// Offscreen frame capture: draw into a RenderTexture2D between captureBegin
+// and captureEnd, every frame comes out as raw top-down RGBA8 pixels.
+//
+// Readback goes through two pixel pack buffers. captureEnd queues an
+// asynchronous glReadPixels for the frame just drawn and only then maps the
+// buffer filled on the previous frame, so the transfer of frame N overlaps
+// the simulation and drawing of frame N+1. Mapped pixels are copied into a
+// small queue that a dedicated thread writes out. Unlike the trajectory
+// recorder no frame is ever dropped: a slow sink blocks the render loop.
+//
+// The output is a file path, "-" for stdout, or "|command" to pipe into a
+// process, e.g. "|ffmpeg -f rawvideo -pix_fmt rgba -s 1920x1200 -r 60 -i - out.mp4".
+// Needs the desktop OpenGL 3.3 backend.
+//
+// With "-" only frames may reach stdout. captureClaimStdout keeps the real
+// stdout for them and points file descriptor 1 at stderr, so raylib's log
+// and every status print go there instead. Call it before InitWindow;
+// captureOpen calls it too, too late for the window's log lines.
+typedef struct Capture Capture;
+
+int captureClaimStdout(void); // -1 when stdout cannot be moved
+Capture* captureOpen(const char* output, int width, int height);
+void captureBegin(Capture* cap);
+void captureEnd(Capture* cap);
+RenderTexture2D captureTarget(const Capture* cap);
+void captureClose(Capture* cap); // drains the last frame and prints totals
@@ -0,0 +1,15 @@
+#include "fastmath.h"
+
+void sinCosBlock(const float* angle, float* sine, float* cosine, int n) {
+    #pragma omp simd
+    for (int i = 0; i < n; i++) {
+        sine[i] = fastSin(angle[i]);
+        cosine[i] = fastCos(angle[i]);
+    }
+}
+
+void atan2Block(const float* y, const float* x, float* out, int n) {
+    #pragma omp simd
+    for (int i = 0; i < n; i++)
+        out[i] = fastAtan2(y[i], x[i]);
+}
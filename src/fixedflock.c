@@ -0,0 +1,346 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+
+#include "fixedflock.h"
+
+#define UNIT (1 << FIXED_SHIFT)
+#define RADIUS (50 * UNIT)
+#define MAX_NEIGHBORS 128
+#define MAX_CELLS (1 << 26) // dense grid limit, about 256 MB of cell starts
+#define SIN_BITS 14 // sine table entries per turn, as a power of two
+#define SIN_ONE 32767
+#define ATAN_BITS 10 // atan table entries up to a ratio of 1, as a power of two
+#define TWO_PI_Q30 6746518852LL // 2 pi in 2^30 units
+
+static int16_t sinTable[1 << SIN_BITS];
+static uint16_t atanTable[(1 << ATAN_BITS) + 1]; // eighth-turn angles of ratio k / 2^ATAN_BITS
+static int tablesReady;
+
+// sine of a quarter turn or less in 2^30 units, Taylor series in integers
+static int64_t sinQ30(int64_t units) {
+    int64_t x = units * TWO_PI_Q30 / FIXED_TURN;
+    int64_t term = x, sum = x;
+
+    for (int n = 1; n < 10; n++) {
+        term = -(term * x / (1LL << 30)) * x / (1LL << 30);
+        term /= (2 * n) * (2 * n + 1);
+        sum += term;
+    }
+
+    return sum;
+}
+
+static void buildTables(void) {
+    const int size = 1 << SIN_BITS;
+    const int step = FIXED_TURN / size;
+
+    for (int k = 0; k <= size / 4; k++) {
+        int16_t s = (int16_t)((sinQ30((int64_t)k * step) * SIN_ONE + (1LL << 29)) >> 30);
+        sinTable[k] = s;
+        sinTable[size / 2 - k] = s;
+        sinTable[(size / 2 + k) % size] = -s;
+        if (k)
+            sinTable[size - k] = -s;
+    }
+
+    // smallest angle whose tangent reaches each ratio
+    for (int k = 0; k <= 1 << ATAN_BITS; k++) {
+        int lo = 0, hi = FIXED_TURN / 8;
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (sinQ30(mid) << ATAN_BITS >= (int64_t)k * sinQ30(FIXED_TURN / 4 - mid))
+                hi = mid;
+            else
+                lo = mid + 1;
+        }
+        atanTable[k] = (uint16_t)lo;
+    }
+
+    tablesReady = 1;
+}
+
+static int fixedSin(uint16_t angle) {
+    return sinTable[angle >> (16 - SIN_BITS)];
+}
+
+static int fixedCos(uint16_t angle) {
+    return fixedSin((uint16_t)(angle + FIXED_TURN / 4));
+}
+
+// heading whose sine follows s and cosine follows c
+static uint16_t fixedAtan2(int64_t s, int64_t c) {
+    int64_t as = s < 0 ? -s : s;
+    int64_t ac = c < 0 ? -c : c;
+    if (!as && !ac)
+        return 0;
+
+    int steep = as > ac;
+    int64_t lo = steep ? ac : as, hi = steep ? as : ac;
+
+    // ratio with 6 more bits to interpolate between entries
+    int64_t q = (lo << (ATAN_BITS + 6)) / hi;
+    int k = (int)(q >> 6), f = (int)(q & 63);
+    int t = atanTable[k];
+    if (k < 1 << ATAN_BITS)
+        t += (atanTable[k + 1] - atanTable[k]) * f / 64;
+
+    if (steep)
+        t = FIXED_TURN / 4 - t;
+    if (c < 0)
+        t = FIXED_TURN / 2 - t;
+    if (s < 0)
+        t = -t;
+
+    return (uint16_t)t;
+}
+
+// same convention as rotationTo in flock.c: 0 points up, toward smaller y
+static uint16_t headingTo(int32_t x1, int32_t y1, int64_t x2, int64_t y2) {
+    return fixedAtan2(x2 - x1, (int64_t)y1 - y2);
+}
+
+// signed shortest turn
+static int turnOf(uint16_t delta) {
+    return delta >= FIXED_TURN / 2 ? (int)delta - FIXED_TURN : delta;
+}
+
+static int32_t wrap(int64_t v, int32_t size) {
+    v %= size;
+    return (int32_t)(v < 0 ? v + size : v);
+}
+
+int fixedCreate(FixedFlock* fixed, const Flock* flock, int rate) {
+    memset(fixed, 0, sizeof(*fixed));
+
+    double width = (double)flock->width * UNIT, height = (double)flock->height * UNIT;
+    if (rate <= 0 || width < 1 || height < 1 || width >= INT32_MAX / 2 || height >= INT32_MAX / 2) {
+        fprintf(stderr, "fixedflock: world or rate out of range\n");
+        return -1;
+    }
+    if (flock->speciesCount > 1) {
+        fprintf(stderr, "fixedflock: only the default species has fixed point rules\n");
+        return -1;
+    }
+
+    int32_t w = (int32_t)lrint(width), h = (int32_t)lrint(height);
+    long long cells = (long long)(w / RADIUS + 1) * (h / RADIUS + 1);
+    if (cells > MAX_CELLS) {
+        fprintf(stderr, "fixedflock: world too large for a dense grid (%lld cells)\n", cells);
+        return -1;
+    }
+
+    if (!tablesReady)
+        buildTables();
+
+    int n = flock->count;
+    fixed->count = n;
+    fixed->width = w;
+    fixed->height = h;
+    fixed->rate = rate;
+    fixed->columns = w / RADIUS + 1;
+    fixed->rows = h / RADIUS + 1;
+
+    fixed->x = malloc(n * sizeof(int32_t));
+    fixed->y = malloc(n * sizeof(int32_t));
+    fixed->rotation = malloc(n * sizeof(uint16_t));
+    fixed->previousX = malloc(n * sizeof(int32_t));
+    fixed->previousY = malloc(n * sizeof(int32_t));
+    fixed->previousRotation = malloc(n * sizeof(uint16_t));
+    fixed->speedX = malloc(n * sizeof(int32_t));
+    fixed->speedY = malloc(n * sizeof(int32_t));
+    fixed->angularVelocity = malloc(n * sizeof(int32_t));
+    fixed->cellStart = malloc((cells + 1) * sizeof(int));
+    fixed->order = malloc(n * sizeof(int));
+
+    int missing = !fixed->x || !fixed->y || !fixed->rotation || !fixed->previousX || !fixed->previousY || !fixed->previousRotation
+                  || !fixed->speedX || !fixed->speedY || !fixed->angularVelocity || !fixed->order;
+    if ((n && missing) || !fixed->cellStart) {
+        fprintf(stderr, "fixedflock: out of memory\n");
+        fixedDestroy(fixed);
+        return -1;
+    }
+
+    const double turn = FIXED_TURN / (2 * M_PI);
+
+    for (int i = 0; i < n; i++) {
+        fixed->x[i] = wrap(lrint((double)flock->x[i] * UNIT), w);
+        fixed->y[i] = wrap(lrint((double)flock->y[i] * UNIT), h);
+        fixed->rotation[i] = (uint16_t)(lrint(flock->rotation[i] * turn) & (FIXED_TURN - 1));
+        fixed->speedX[i] = (int32_t)lrint((double)flock->speedX[i] * UNIT);
+        fixed->speedY[i] = (int32_t)lrint((double)flock->speedY[i] * UNIT);
+        fixed->angularVelocity[i] = (int32_t)lrint(flock->angularVelocity[i] * turn);
+    }
+
+    return 0;
+}
+
+void fixedDestroy(FixedFlock* fixed) {
+    free(fixed->x);
+    free(fixed->y);
+    free(fixed->rotation);
+    free(fixed->previousX);
+    free(fixed->previousY);
+    free(fixed->previousRotation);
+    free(fixed->speedX);
+    free(fixed->speedY);
+    free(fixed->angularVelocity);
+    free(fixed->cellStart);
+    free(fixed->order);
+    memset(fixed, 0, sizeof(*fixed));
+}
+
+static int cellOf(const FixedFlock* fixed, int32_t x, int32_t y) {
+    return (y / RADIUS) * fixed->columns + x / RADIUS;
+}
+
+// counting sort of the previous state by cell, ascending index within a cell
+static void buildGrid(FixedFlock* fixed) {
+    int cells = fixed->columns * fixed->rows;
+    int* start = fixed->cellStart;
+
+    memset(start, 0, (cells + 1) * sizeof(int));
+    for (int i = 0; i < fixed->count; i++)
+        start[cellOf(fixed, fixed->previousX[i], fixed->previousY[i])]++;
+
+    int sum = 0;
+    for (int c = 0; c < cells; c++) {
+        int n = start[c];
+        start[c] = sum;
+        sum += n;
+    }
+
+    // fills each cell, leaving start[c] at the next cell's start
+    for (int i = 0; i < fixed->count; i++)
+        fixed->order[start[cellOf(fixed, fixed->previousX[i], fixed->previousY[i])]++] = i;
+
+    memmove(start + 1, start, cells * sizeof(int));
+    start[0] = 0;
+}
+
+// same rules as updateOne in flock.c, in integers
+static void updateOne(FixedFlock* fixed, int i) {
+    const int32_t* px = fixed->previousX;
+    const int32_t* py = fixed->previousY;
+    const uint16_t* pr = fixed->previousRotation;
+    int32_t x = px[i], y = py[i];
+    uint16_t rotation = pr[i];
+
+    int column = x / RADIUS, row = y / RADIUS;
+    int count = 0, closest = -1;
+    int64_t closestDistance = 0;
+    int64_t sumRotation = 0, sumX = 0, sumY = 0;
+
+    // fixed cell order, so the neighbor cap keeps the same boids on any thread count
+    for (int r = row - 1; r <= row + 1 && count < MAX_NEIGHBORS; r++) {
+        if (r < 0 || r >= fixed->rows)
+            continue;
+
+        for (int c = column - 1; c <= column + 1 && count < MAX_NEIGHBORS; c++) {
+            if (c < 0 || c >= fixed->columns)
+                continue;
+
+            int cell = r * fixed->columns + c;
+            for (int k = fixed->cellStart[cell]; k < fixed->cellStart[cell + 1] && count < MAX_NEIGHBORS; k++) {
+                int j = fixed->order[k];
+                int64_t dx = px[j] - x, dy = py[j] - y;
+                int64_t distance = dx * dx + dy * dy;
+                if (j == i || distance >= (int64_t)RADIUS * RADIUS)
+                    continue;
+
+                count++;
+                sumRotation += pr[j];
+                sumX += px[j];
+                sumY += py[j];
+
+                if (closest < 0 || distance < closestDistance) {
+                    closest = j;
+                    closestDistance = distance;
+                }
+            }
+        }
+    }
+
+    int turn = 0;
+
+    if (count) {
+        uint16_t alignment = (uint16_t)(sumRotation / count);
+        turn = turnOf((uint16_t)(alignment - rotation));
+
+        if (alignment != rotation && closestDistance > 0) {
+            if (closestDistance >= (int64_t)(30 * UNIT) * (30 * UNIT))
+                turn = turnOf((uint16_t)(headingTo(x, y, sumX / count, sumY / count) - rotation));
+
+            if (closestDistance <= (int64_t)(10 * UNIT) * (10 * UNIT)) {
+                uint16_t separation = rotation;
+                if (closestDistance <= (int64_t)(5 * UNIT) * (5 * UNIT))
+                    separation = (uint16_t)(headingTo(x, y, px[closest], py[closest]) + FIXED_TURN / 2);
+                turn = turnOf((uint16_t)(separation - rotation));
+            }
+        }
+    }
+
+    int maximumTurn = fixed->angularVelocity[i] / fixed->rate;
+    if (turn > maximumTurn)
+        turn = maximumTurn;
+    if (turn < -maximumTurn)
+        turn = -maximumTurn;
+
+    rotation = (uint16_t)(rotation + turn);
+    fixed->rotation[i] = rotation;
+
+    int64_t scale = (int64_t)SIN_ONE * fixed->rate;
+    fixed->x[i] = wrap(x + (int64_t)fixedSin(rotation) * fixed->speedX[i] / scale, fixed->width);
+    fixed->y[i] = wrap(y - (int64_t)fixedCos(rotation) * fixed->speedY[i] / scale, fixed->height);
+}
+
+void fixedStep(FixedFlock* fixed) {
+    int32_t* x = fixed->previousX;
+    int32_t* y = fixed->previousY;
+    uint16_t* rotation = fixed->previousRotation;
+
+    fixed->previousX = fixed->x;
+    fixed->previousY = fixed->y;
+    fixed->previousRotation = fixed->rotation;
+    fixed->x = x;
+    fixed->y = y;
+    fixed->rotation = rotation;
+
+    buildGrid(fixed);
+
+    #pragma omp parallel for schedule(dynamic, 256)
+    for (int i = 0; i < fixed->count; i++)
+        updateOne(fixed, i);
+
+    fixed->steps++;
+}
+
+void fixedToFlock(const FixedFlock* fixed, Flock* flock) {
+    const float unit = 1.0f / UNIT;
+    const float radians = (float)(2 * M_PI / FIXED_TURN);
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < fixed->count; i++) {
+        flock->x[i] = fixed->x[i] * unit;
+        flock->y[i] = fixed->y[i] * unit;
+        flock->rotation[i] = fixed->rotation[i] * radians;
+    }
+}
+
+uint64_t fixedChecksum(const FixedFlock* fixed) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (int i = 0; i < fixed->count; i++) {
+        uint32_t values[3] = {(uint32_t)fixed->x[i], (uint32_t)fixed->y[i], fixed->rotation[i]};
+        for (int v = 0; v < 3; v++) {
+            for (int b = 0; b < 4; b++) {
+                hash ^= (values[v] >> (8 * b)) & 0xff;
+                hash *= 1099511628211ULL;
+            }
+        }
+    }
+
+    return hash;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+#include "flock.h"
+
+// Fixed-point flock for runs that must give the same bits everywhere.
+//
+// Positions are 32-bit integers in 1/1024 px, headings 16-bit angles with
+// 65536 units per turn, so wrapping a heading is plain integer overflow.
+// Sine, cosine and atan2 come from tables that are built with integer
+// arithmetic only, not libm. Distances are compared squared, so no square
+// roots are needed. The timestep is a fixed 1/rate of a second.
+//
+// Steps are synchronous: every boid reads its neighbors from the previous
+// state and writes the next one, and neighbors are visited in a fixed cell
+// order. Together with integer math, the result does not depend on the
+// compiler, its flags (-O3, -ffast-math) or the thread count, which
+// fixedChecksum makes easy to compare.
+#define FIXED_SHIFT 10 // position units per pixel, as a power of two
+#define FIXED_TURN 65536 // angle units per turn
+
+typedef struct FixedFlock {
+    int count;
+    int32_t width; // position units, at most 2^31 / 2
+    int32_t height;
+    int rate; // steps per second
+    uint64_t steps;
+
+    // current state, and the previous one steps read from
+    int32_t* x;
+    int32_t* y;
+    uint16_t* rotation;
+    int32_t* previousX;
+    int32_t* previousY;
+    uint16_t* previousRotation;
+
+    int32_t* speedX; // position units per second
+    int32_t* speedY;
+    int32_t* angularVelocity; // angle units per second
+
+    // boids bucketed by neighbor radius cells, rebuilt every step
+    int columns;
+    int rows;
+    int* cellStart;
+    int* order;
+} FixedFlock;
+
+// converts flock to fixed point, rounding each value to the nearest unit
+int fixedCreate(FixedFlock* fixed, const Flock* flock, int rate);
+void fixedDestroy(FixedFlock* fixed);
+void fixedStep(FixedFlock* fixed);
+void fixedToFlock(const FixedFlock* fixed, Flock* flock); // for drawing, flock must have the same count
+uint64_t fixedChecksum(const FixedFlock* fixed); // FNV-1a over positions and headings
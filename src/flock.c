@@ -0,0 +1,1215 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include <sys/mman.h>
+
+#include "flock.h"
+#include "fastmath.h"
+#include "grid.h"
+#include "trace.h"
+
+#define MODULO(a, n) fmod((a), (n)) + (((a) < 0) * (n))
+#define TWO_PI 6.28318530717958647692f
+#define INVERSE(theta) fmod((theta)+M_PI, 2*M_PI)
+#define MAX_NEIGHBORS 128
+#define COLUMNS 6
+#define MAX_LINES 6 // cell rows or columns searched, enough while a step moves less than the radius
+#define VERLET_SKIN 10 // extra radius kept in reused neighbor lists
+
+// Verlet lists: every boid within the radius plus a skin, kept while no
+// boid can have moved half the skin since they were built, so nothing
+// outside a list can have come within the radius
+typedef struct NeighborLists {
+    int* neighbors; // capacity entries per boid
+    int* counts;
+    int capacity;
+    int count; // boids the lists were built for, 0 when stale
+    float travel; // furthest any boid may have moved since the build
+    size_t entries; // allocated
+    int boids;
+} NeighborLists;
+
+// what the pair traversal gathers for each boid, in place of its neighbor list
+typedef struct PairSums {
+    int* count;
+    int* nearest; // closest neighbor, -1 for none
+    float* closest; // its distance
+    float* rotation;
+    float* x;
+    float* y;
+    int boids; // allocated
+} PairSums;
+
+// one thread's copy of a tile of cells and the cells around it, cell by
+// cell in row-major order, ascending boid index within a cell
+typedef struct TileScratch {
+    float* x;
+    float* y;
+    float* rotation;
+    int* index; // boid in the flock
+    int capacity;
+    int* cellStart; // one per copied cell, plus the end
+    int cells;
+} TileScratch;
+
+// triangle template in boid space, same as newBoid
+static const float shape[6] = {0.0f, -5.0f, -5.0f, 5.0f, 5.0f, 5.0f};
+
+static const Species defaultSpecies = SPECIES_DEFAULT;
+
+// one species of every boid
+static void speciesDefaults(Flock* flock) {
+    flock->speciesCount = 1;
+    flock->species[0] = defaultSpecies;
+    flock->speciesStart[0] = 0;
+    flock->speciesStart[1] = flock->count;
+}
+
+// cells as wide as the largest radius, so the 3x3 block around any boid covers it
+static float flockRadius(const Flock* flock) {
+    float radius = flock->speciesCount ? 0 : defaultSpecies.radius;
+
+    for (int s = 0; s < flock->speciesCount; s++)
+        radius = fmaxf(radius, flock->species[s].radius);
+
+    return radius;
+}
+
+size_t flockColumnStride(int count) {
+    size_t bytes = sizeof(float) * (size_t)count;
+    return (bytes + FLOCK_ALIGNMENT - 1) & ~(size_t)(FLOCK_ALIGNMENT - 1);
+}
+
+int flockCreate(Flock* flock, int count, float width, float height) {
+    size_t stride = flockColumnStride(count);
+    size_t size = stride * COLUMNS;
+
+    memset(flock, 0, sizeof(*flock));
+
+    char* storage = aligned_alloc(FLOCK_ALIGNMENT, size ? size : FLOCK_ALIGNMENT);
+    if (!storage)
+        return -1;
+    memset(storage, 0, size);
+
+    flock->count = count;
+    flock->width = width;
+    flock->height = height;
+    flock->x = (float*)(storage + 0 * stride);
+    flock->y = (float*)(storage + 1 * stride);
+    flock->rotation = (float*)(storage + 2 * stride);
+    flock->speedX = (float*)(storage + 3 * stride);
+    flock->speedY = (float*)(storage + 4 * stride);
+    flock->angularVelocity = (float*)(storage + 5 * stride);
+    flock->storage = storage;
+    flock->storageSize = size;
+    speciesDefaults(flock);
+
+    return 0;
+}
+
+int flockPlace(Flock* flock, int spatial) {
+    size_t stride = flockColumnStride(flock->count);
+    size_t size = stride * COLUMNS;
+    int* order = NULL;
+
+    if (!flock->speciesCount)
+        speciesDefaults(flock);
+
+    // row-major cell order, so each thread's chunk is a band of the world
+    if (spatial) {
+        Grid grid;
+        if (gridInit(&grid, flock->width, flock->height, flockRadius(flock), flock->count, GRID_AUTO) == 0
+            && gridBuild(&grid, flock) == 0) {
+            order = grid.indices;
+            grid.indices = NULL;
+        }
+        gridFree(&grid);
+    }
+
+    // species keep their runs, in cell order within each
+    if (order && flock->speciesCount > 1) {
+        int* grouped = malloc(flock->count * sizeof(int));
+        int next[FLOCK_MAX_SPECIES];
+
+        memcpy(next, flock->speciesStart, sizeof(next));
+        for (int k = 0; grouped && k < flock->count; k++)
+            grouped[next[flockSpeciesOf(flock, order[k])]++] = order[k];
+
+        free(order);
+        order = grouped;
+    }
+
+    // not touched here, the pages land wherever the copy below first writes them
+    char* storage = aligned_alloc(FLOCK_ALIGNMENT, size ? size : FLOCK_ALIGNMENT);
+    if (!storage) {
+        free(order);
+        return -1;
+    }
+
+    const float* from[COLUMNS] = {
+        flock->x, flock->y, flock->rotation, flock->speedX, flock->speedY, flock->angularVelocity
+    };
+
+    // same static split as the step loop, run by run, so every thread
+    // copies its own boids
+    for (int s = 0; s < flock->speciesCount; s++) {
+        #pragma omp parallel for schedule(static)
+        for (int i = flock->speciesStart[s]; i < flock->speciesStart[s + 1]; i++) {
+            int src = order ? order[i] : i;
+            for (int c = 0; c < COLUMNS; c++)
+                ((float*)(storage + c * stride))[i] = from[c][src];
+        }
+    }
+
+    free(order);
+
+    if (flock->mapped)
+        munmap(flock->storage, flock->storageSize);
+    else
+        free(flock->storage);
+
+    flock->x = (float*)(storage + 0 * stride);
+    flock->y = (float*)(storage + 1 * stride);
+    flock->rotation = (float*)(storage + 2 * stride);
+    flock->speedX = (float*)(storage + 3 * stride);
+    flock->speedY = (float*)(storage + 4 * stride);
+    flock->angularVelocity = (float*)(storage + 5 * stride);
+    flock->storage = storage;
+    flock->storageSize = size;
+    flock->mapped = 0;
+    flock->placed = 1;
+    flock->placeInterval = spatial ? FLOCK_PLACE_INTERVAL : 0;
+    flock->placeSteps = 0;
+    if (flock->lists)
+        flock->lists->count = 0; // indices changed
+
+    return 0;
+}
+
+void flockDestroy(Flock* flock) {
+    if (flock->grid) {
+        gridFree(flock->grid);
+        free(flock->grid);
+    }
+    free(flock->previous);
+    if (flock->lists) {
+        free(flock->lists->neighbors);
+        free(flock->lists->counts);
+        free(flock->lists);
+    }
+    if (flock->pairs) {
+        free(flock->pairs->count);
+        free(flock->pairs);
+    }
+    for (int t = 0; t < flock->tileThreads; t++) {
+        free(flock->tiles[t].x);
+        free(flock->tiles[t].cellStart);
+    }
+    free(flock->tiles);
+
+    if (flock->mapped)
+        munmap(flock->storage, flock->storageSize);
+    else
+        free(flock->storage);
+
+    memset(flock, 0, sizeof(*flock));
+}
+
+void flockSetBoid(Flock* flock, int i, float x, float y, float rotation, float speedX, float speedY, float angularVelocity) {
+    flock->x[i] = x;
+    flock->y[i] = y;
+    flock->rotation[i] = fmod(rotation, 2*M_PI);
+    flock->speedX[i] = speedX;
+    flock->speedY[i] = speedY;
+    flock->angularVelocity[i] = angularVelocity;
+}
+
+int flockGroupSpecies(Flock* flock, const Species* species, const int* counts, int speciesCount) {
+    int total = 0;
+
+    if (speciesCount < 1 || speciesCount > FLOCK_MAX_SPECIES)
+        return -1;
+
+    for (int s = 0; s < speciesCount; s++) {
+        const Species* sp = &species[s];
+        if (counts[s] < 0 || counts[s] > flock->count - total || !(sp->radius > 0) || !(sp->speed >= 0) || !(sp->angularVelocity >= 0))
+            return -1;
+        for (int t = 0; t < speciesCount; t++)
+            if (sp->interaction[t] > SPECIES_IGNORE)
+                return -1;
+        total += counts[s];
+    }
+    if (total != flock->count)
+        return -1;
+
+    for (int s = 0, first = 0; s < speciesCount; first += counts[s++]) {
+        flock->species[s] = species[s];
+        flock->speciesStart[s] = first;
+    }
+    flock->speciesStart[speciesCount] = flock->count;
+    flock->speciesCount = speciesCount;
+
+    // cell size and lists follow the radii
+    if (flock->grid) {
+        gridFree(flock->grid);
+        free(flock->grid);
+        flock->grid = NULL;
+    }
+    if (flock->lists)
+        flock->lists->count = 0;
+
+    return 0;
+}
+
+int flockSetSpecies(Flock* flock, const Species* species, const int* counts, int speciesCount) {
+    if (flockGroupSpecies(flock, species, counts, speciesCount))
+        return -1;
+
+    for (int s = 0; s < speciesCount; s++) {
+        for (int i = flock->speciesStart[s]; i < flock->speciesStart[s + 1]; i++) {
+            flock->speedX[i] = flock->speedY[i] = species[s].speed;
+            flock->angularVelocity[i] = species[s].angularVelocity;
+        }
+    }
+
+    return 0;
+}
+
+int flockSpeciesOf(const Flock* flock, int i) {
+    int s = 0;
+
+    while (s < flock->speciesCount - 1 && i >= flock->speciesStart[s + 1])
+        s++;
+
+    return s;
+}
+
+void flockTriangle(const Flock* flock, int i, float out[6]) {
+    float s = fastSin(flock->rotation[i]);
+    float c = fastCos(flock->rotation[i]);
+
+    for (int v = 0; v < 3; v++) {
+        float px = shape[2*v], py = shape[2*v + 1];
+        out[2*v] = c * px - s * py + flock->x[i];
+        out[2*v + 1] = s * px + c * py + flock->y[i];
+    }
+}
+
+// columns neighbors are read from: the live ones when updating in place,
+// a copy from the start of the step when synchronous
+typedef struct Source {
+    const float* x;
+    const float* y;
+    const float* rotation;
+} Source;
+
+static float distanceTo(const Source* src, int i, int j) {
+    float dx = src->x[i] - src->x[j];
+    float dy = src->y[i] - src->y[j];
+    return sqrtf(dx*dx + dy*dy);
+}
+
+static float rotationTo(float x1, float y1, float x2, float y2) {
+    return fastAtan2(-(x1 - x2), y1 - y2);
+}
+
+static int bruteNeighbors(const Flock* flock, const Source* src, int i, float radius, int cap, int* neighbors) {
+    int count = 0;
+
+    for (int j = 0; j < flock->count; j++) {
+        if (j != i && distanceTo(src, i, j) < radius) {
+            neighbors[count++] = j;
+
+            if (count == cap)
+                break;
+        }
+    }
+
+    return count;
+}
+
+// collects the cell rows (or columns) within reach of v, plus the far edge
+// when a boid could have wrapped in from there
+static int reachLines(float v, float reach, float size, int lines, float cellSize, int* out) {
+    int first = (int)floorf((v - reach) / cellSize);
+    int last = (int)floorf((v + reach) / cellSize);
+    int n = 0;
+
+    if (first < 0)
+        first = 0;
+    if (last > lines - 1)
+        last = lines - 1;
+    if (last - first + 1 > MAX_LINES - 2)
+        return -1;
+
+    for (int l = first; l <= last; l++)
+        out[n++] = l;
+    if (v - reach < 0 && last < lines - 1)
+        out[n++] = lines - 1;
+    if (v + reach >= size && first > 0)
+        out[n++] = 0;
+
+    return n;
+}
+
+// merges the cells within reach of i by index, so the first cap neighbors
+// found are the same ones the full scan keeps. Boids earlier in the loop
+// have already moved this step, so reach adds the largest step to the
+// radius and the far edges are searched for boids that just wrapped.
+static int gridNeighbors(const Flock* flock, const Source* src, const Grid* grid, int i, float reach, float radius, int cap, int* neighbors) {
+    int begin[MAX_LINES * MAX_LINES], end[MAX_LINES * MAX_LINES], ranges = 0;
+    int rows[MAX_LINES], columns[MAX_LINES];
+
+    int rowCount = reachLines(src->y[i], reach, flock->height, grid->rows, grid->cellSize, rows);
+    int columnCount = reachLines(src->x[i], reach, flock->width, grid->columns, grid->cellSize, columns);
+    if (rowCount < 0 || columnCount < 0)
+        return bruteNeighbors(flock, src, i, radius, cap, neighbors);
+
+    for (int r = 0; r < rowCount; r++) {
+        for (int c = 0; c < columnCount; c++) {
+            if (gridCellRange(grid, columns[c], rows[r], &begin[ranges], &end[ranges]))
+                ranges++;
+        }
+    }
+
+    int count = 0;
+
+    while (ranges && count < cap) {
+        int m = 0;
+        for (int k = 1; k < ranges; k++)
+            if (grid->indices[begin[k]] < grid->indices[begin[m]])
+                m = k;
+
+        int j = grid->indices[begin[m]++];
+        if (begin[m] == end[m]) {
+            ranges--;
+            begin[m] = begin[ranges];
+            end[m] = end[ranges];
+        }
+
+        if (j != i && distanceTo(src, i, j) < radius)
+            neighbors[count++] = j;
+    }
+
+    return count;
+}
+
+// how one step finds neighbors: reused lists, the grid, or a full scan
+typedef struct Search {
+    const NeighborLists* lists;
+    const Grid* grid;
+    float travel; // added to the radius on the grid, boids earlier in the loop have already moved
+    int cap;
+} Search;
+
+static int listNeighbors(const Source* src, const NeighborLists* lists, int i, float radius, int cap, int* neighbors) {
+    const int* list = lists->neighbors + (size_t)i * lists->capacity;
+    int count = 0;
+
+    for (int k = 0; k < lists->counts[i] && count < cap; k++)
+        if (distanceTo(src, i, list[k]) < radius)
+            neighbors[count++] = list[k];
+
+    return count;
+}
+
+static int findNeighbors(const Flock* flock, const Source* src, const Search* search, int i, float radius, int* neighbors) {
+    if (search->lists)
+        return listNeighbors(src, search->lists, i, radius, search->cap, neighbors);
+    if (search->grid)
+        return gridNeighbors(flock, src, search->grid, i, radius + search->travel, radius, search->cap, neighbors);
+    return bruteNeighbors(flock, src, i, radius, search->cap, neighbors);
+}
+
+// species of boid j, moving from s, the species of the boid before it.
+// Neighbors come in ascending index order, so this mostly stays put.
+static int speciesFrom(const Flock* flock, int s, int j) {
+    while (j < flock->speciesStart[s])
+        s--;
+    while (j >= flock->speciesStart[s + 1])
+        s++;
+    return s;
+}
+
+// keeps the neighbors the species follows, in order, and leaves the
+// nearest one it avoids in *avoid, -1 for none
+static int followedNeighbors(const Flock* flock, const Source* src, const Species* species, int self, int* neighbors, int count, int* avoid) {
+    int kept = 0, s = 0;
+    float nearest = 0;
+
+    *avoid = -1;
+    for (int n = 0; n < count; n++) {
+        int j = neighbors[n];
+        s = speciesFrom(flock, s, j);
+
+        if (species->interaction[s] == SPECIES_FOLLOW) {
+            neighbors[kept++] = j;
+        } else if (species->interaction[s] == SPECIES_AVOID) {
+            float dist = distanceTo(src, self, j);
+            if (*avoid < 0 || dist < nearest) {
+                *avoid = j;
+                nearest = dist;
+            }
+        }
+    }
+
+    return kept;
+}
+
+// a heading change brought into (-pi, pi], at most maximumRotation either way
+static float limitTurn(float targetRotation, float maximumRotation) {
+    targetRotation = MODULO(targetRotation, 2*M_PI);
+
+    if (targetRotation > M_PI)
+        targetRotation = INVERSE(targetRotation)-M_PI;
+
+    if (targetRotation > maximumRotation)
+        targetRotation = maximumRotation;
+
+    if (targetRotation < -maximumRotation)
+        targetRotation = -maximumRotation;
+
+    return targetRotation;
+}
+
+// turn toward whichever rule applies
+static float steer(const Species* species, float rotation, float alignment, float cohesion, float separation, float closestBoid, float maximumRotation) {
+    float targetRotation = alignment - rotation;
+
+    if (fabs(rotation - alignment) > 0 && closestBoid > 0) {
+        if (closestBoid >= species->cohesion)
+            targetRotation = cohesion - rotation;
+
+        if (closestBoid <= species->separation)
+            targetRotation = separation - rotation;
+    }
+
+    return limitTurn(targetRotation, maximumRotation);
+}
+
+// back into [0, size) by a conditional add or subtract, enough while a
+// step moves a boid less than the world size
+#pragma omp declare simd
+static inline float wrapPosition(float v, float size) {
+    v = fastSelect(v < 0.0f, v + size, v);
+    return fastSelect(v >= size, v - size, v);
+}
+
+// fmod by 2 pi for a heading plus one turn, keeping the sign, so headings
+// stay in (-2 pi, 2 pi) as the rules expect
+#pragma omp declare simd
+static inline float wrapHeading(float r) {
+    r = fastSelect(r >= TWO_PI, r - TWO_PI, r);
+    return fastSelect(r <= -TWO_PI, r + TWO_PI, r);
+}
+
+// boid i moves off from (x, y) along its new heading
+static void integrate(Flock* flock, int i, float x, float y, float rotation, float deltaTime) {
+    rotation = wrapHeading(rotation);
+    flock->rotation[i] = rotation;
+
+    flock->x[i] = wrapPosition(x + fastSin(rotation) * flock->speedX[i] * deltaTime, flock->width);
+    flock->y[i] = wrapPosition(y - fastCos(rotation) * flock->speedY[i] * deltaTime, flock->height);
+}
+
+// the second half of a synchronous step: boids that stepped turn by
+// turn[i], written by the rules, and move, in one branch-free pass over
+// the columns. make vec-check fails unless both loops vectorize.
+static void integrateColumns(Flock* flock, const float* turn, const unsigned char* steps, double deltaTime) {
+    float* x = flock->x;
+    float* y = flock->y;
+    float* rotation = flock->rotation;
+    const float* speedX = flock->speedX;
+    const float* speedY = flock->speedY;
+    float width = flock->width, height = flock->height, dt = deltaTime;
+    int n = flock->count;
+
+    TRACE_BEGIN("integration");
+    if (steps) {
+        // turn is only written for boids that step
+        #pragma omp parallel for simd schedule(static)
+        for (int i = 0; i < n; i++) {
+            int active = steps[i] != 0;
+            float t = dt * steps[i];
+            float r = fastSelect(active, wrapHeading(rotation[i] + turn[i]), rotation[i]);
+            x[i] = fastSelect(active, wrapPosition(x[i] + fastSin(r) * speedX[i] * t, width), x[i]);
+            y[i] = fastSelect(active, wrapPosition(y[i] - fastCos(r) * speedY[i] * t, height), y[i]);
+            rotation[i] = r;
+        }
+    } else {
+        #pragma omp parallel for simd schedule(static)
+        for (int i = 0; i < n; i++) {
+            float r = wrapHeading(rotation[i] + turn[i]);
+            x[i] = wrapPosition(x[i] + fastSin(r) * speedX[i] * dt, width);
+            y[i] = wrapPosition(y[i] - fastCos(r) * speedY[i] * dt, height);
+            rotation[i] = r;
+        }
+    }
+    TRACE_END("integration");
+}
+
+// same rules as updateAllBoids in boids.c, on columns, with the
+// parameters of the boid's species. Boid i of the flock is boid self of
+// src, and neighbors index src. With turn the boid's heading change is
+// left there for integrateColumns, otherwise it moves right away. In mixed
+// flocks neighbors of other species may be dropped from the list first.
+static void applyRules(Flock* flock, const Source* src, const Species* species, int self, int* neighbors, int count, int i, float* turn, double deltaTime) {
+    TRACE_BEGIN("rules");
+    float rotation = src->rotation[self];
+    float alignment = rotation, cohesion = rotation, separation = rotation;
+    float closestBoid = -1;
+    int avoid = -1;
+
+    if (flock->speciesCount > 1)
+        count = followedNeighbors(flock, src, species, self, neighbors, count, &avoid);
+
+    if (count) {
+        float totalRotations = 0;
+        float meanX = 0, meanY = 0;
+        float closestRotation = 0, closestDistance = 0;
+
+        for (int n = 0; n < count; n++) {
+            int j = neighbors[n];
+            float dist = distanceTo(src, self, j);
+
+            totalRotations += src->rotation[j];
+            meanX += src->x[j];
+            meanY += src->y[j];
+
+            if (dist < closestBoid || closestBoid == -1)
+                closestBoid = dist;
+
+            if (dist < closestDistance || !closestRotation) {
+                closestRotation = rotationTo(src->x[self], src->y[self], src->x[j], src->y[j]);
+                closestDistance = dist;
+            }
+        }
+
+        alignment = totalRotations / count;
+        cohesion = rotationTo(src->x[self], src->y[self], meanX / count, meanY / count);
+
+        if (closestDistance <= species->flee)
+            separation = INVERSE(closestRotation);
+    }
+
+    float maximumRotation = flock->angularVelocity[i] * deltaTime;
+    float targetRotation;
+
+    // the nearest avoided boid comes before every rule
+    if (avoid >= 0)
+        targetRotation = limitTurn(INVERSE(rotationTo(src->x[self], src->y[self], src->x[avoid], src->y[avoid])) - rotation, maximumRotation);
+    else
+        targetRotation = steer(species, rotation, alignment, cohesion, separation, closestBoid, maximumRotation);
+    TRACE_END("rules");
+
+    if (turn) {
+        turn[i] = targetRotation;
+        return;
+    }
+
+    TRACE_BEGIN("integration");
+    integrate(flock, i, src->x[self], src->y[self], rotation + targetRotation, deltaTime);
+    TRACE_END("integration");
+}
+
+static void updateOne(Flock* flock, const Source* src, const Search* search, const Species* species, int i, float* turn, double deltaTime) {
+    int neighbors[MAX_NEIGHBORS];
+    int count;
+
+    TRACE_BEGIN("neighbor search");
+    count = findNeighbors(flock, src, search, i, species->radius, neighbors);
+    TRACE_END("neighbor search");
+
+    applyRules(flock, src, species, i, neighbors, count, i, turn, deltaTime);
+}
+
+static Grid* flockGrid(Flock* flock) {
+    if (!flock->grid) {
+        Grid* grid = malloc(sizeof(Grid));
+        if (!grid || gridInit(grid, flock->width, flock->height, flockRadius(flock), flock->count, GRID_AUTO)) {
+            free(grid);
+            return NULL;
+        }
+        flock->grid = grid;
+    }
+
+    TRACE_BEGIN("grid build");
+    int ok = gridBuild(flock->grid, flock) == 0;
+    TRACE_END("grid build");
+
+    return ok ? flock->grid : NULL;
+}
+
+// the copy read by synchronous steps, x, y and rotation back to back,
+// followed by the turn column integrateColumns reads
+static Source flockPrevious(Flock* flock) {
+    size_t stride = flockColumnStride(flock->count) / sizeof(float);
+
+    if (flock->previousCount < flock->count) {
+        free(flock->previous);
+        flock->previous = aligned_alloc(FLOCK_ALIGNMENT, 4 * stride * sizeof(float));
+        flock->previousCount = flock->previous ? flock->count : 0;
+        if (!flock->previous)
+            return (Source){flock->x, flock->y, flock->rotation};
+    }
+
+    float* x = flock->previous;
+    float* y = x + stride;
+    float* rotation = y + stride;
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < flock->count; i++) {
+        x[i] = flock->x[i];
+        y[i] = flock->y[i];
+        rotation[i] = flock->rotation[i];
+    }
+
+    return (Source){x, y, rotation};
+}
+
+// reuses the lists while they still cover this step, otherwise rebuilds
+// them from the grid. NULL when they cannot be used.
+static const NeighborLists* flockLists(Flock* flock, const Source* src, int cap, float step) {
+    NeighborLists* lists = flock->lists;
+    int capacity = cap + cap / 2; // the skin adds about half the area
+
+    if (lists && lists->count == flock->count && lists->capacity == capacity && lists->travel + step <= VERLET_SKIN / 2) {
+        lists->travel += step;
+        return lists;
+    }
+
+    if (lists)
+        lists->count = 0;
+    if (step > VERLET_SKIN / 2)
+        return NULL;
+
+    if (!lists) {
+        lists = calloc(1, sizeof(NeighborLists));
+        if (!lists)
+            return NULL;
+        flock->lists = lists;
+    }
+
+    size_t entries = (size_t)flock->count * capacity;
+    if (lists->entries < entries || lists->boids < flock->count) {
+        free(lists->neighbors);
+        free(lists->counts);
+        lists->neighbors = malloc(entries * sizeof(int));
+        lists->counts = malloc(flock->count * sizeof(int));
+        if (!lists->neighbors || !lists->counts) {
+            free(lists->neighbors);
+            free(lists->counts);
+            lists->neighbors = lists->counts = NULL;
+            lists->entries = lists->boids = 0;
+            return NULL;
+        }
+        lists->entries = entries;
+        lists->boids = flock->count;
+    }
+
+    const Grid* grid = flockGrid(flock);
+    if (!grid)
+        return NULL;
+
+    TRACE_BEGIN("neighbor lists");
+    for (int s = 0; s < flock->speciesCount; s++) {
+        float radius = flock->species[s].radius + VERLET_SKIN;
+
+        #pragma omp parallel for schedule(dynamic, 256)
+        for (int i = flock->speciesStart[s]; i < flock->speciesStart[s + 1]; i++)
+            lists->counts[i] = gridNeighbors(flock, src, grid, i, radius, radius, capacity, lists->neighbors + (size_t)i * capacity);
+    }
+    TRACE_END("neighbor lists");
+
+    lists->capacity = capacity;
+    lists->count = flock->count;
+    lists->travel = step;
+
+    return lists;
+}
+
+static PairSums* flockPairs(Flock* flock) {
+    PairSums* sums = flock->pairs;
+
+    if (!sums) {
+        sums = calloc(1, sizeof(PairSums));
+        if (!sums)
+            return NULL;
+        flock->pairs = sums;
+    }
+
+    if (sums->boids < flock->count) {
+        free(sums->count);
+        sums->count = malloc((size_t)flock->count * (2 * sizeof(int) + 4 * sizeof(float)));
+        sums->boids = sums->count ? flock->count : 0;
+        if (!sums->count)
+            return NULL;
+    }
+
+    sums->nearest = sums->count + sums->boids;
+    sums->closest = (float*)(sums->nearest + sums->boids);
+    sums->rotation = sums->closest + sums->boids;
+    sums->x = sums->rotation + sums->boids;
+    sums->y = sums->x + sums->boids;
+
+    return sums;
+}
+
+// adds j to i's sums, keeping the nearest the way the list scan does:
+// the lower index wins a tie
+static void pairAdd(PairSums* sums, const Source* src, int i, int j, float dist) {
+    sums->count[i]++;
+    sums->rotation[i] += src->rotation[j];
+    sums->x[i] += src->x[j];
+    sums->y[i] += src->y[j];
+
+    if (sums->nearest[i] < 0 || dist < sums->closest[i] || (dist == sums->closest[i] && j < sums->nearest[i])) {
+        sums->closest[i] = dist;
+        sums->nearest[i] = j;
+    }
+}
+
+// every pair within radius between boids a[0..na) and b[0..nb), or within a when b is a
+static void pairCells(PairSums* sums, const Source* src, float radius, const int* a, int na, const int* b, int nb) {
+    for (int p = 0; p < na; p++) {
+        int i = a[p];
+        float x = src->x[i], y = src->y[i];
+
+        for (int q = b == a ? p + 1 : 0; q < nb; q++) {
+            int j = b[q];
+            float dx = x - src->x[j];
+            float dy = y - src->y[j];
+            float dist = sqrtf(dx*dx + dy*dy);
+
+            if (dist < radius) {
+                pairAdd(sums, src, i, j, dist);
+                pairAdd(sums, src, j, i, dist);
+            }
+        }
+    }
+}
+
+// the cells of one row against themselves and the half of their
+// neighbors that comes after them: east, and south-west, south and
+// south-east in the next row. Every neighboring pair of cells is visited
+// once, and only rows row and row + 1 are written.
+static void pairRow(PairSums* sums, const Source* src, const Grid* grid, float radius, int row) {
+    const int* indices = grid->indices;
+    int begin, end;
+
+    gridRowRange(grid, row, 0, grid->columns - 1, &begin, &end);
+
+    while (begin < end) {
+        int column = (int)(src->x[indices[begin]] / grid->cellSize);
+        column = column < 0 ? 0 : column > grid->columns - 1 ? grid->columns - 1 : column;
+
+        int cellEnd;
+        gridCellRange(grid, column, row, &begin, &cellEnd);
+
+        const int* cell = indices + begin;
+        int n = cellEnd - begin;
+        pairCells(sums, src, radius, cell, n, cell, n);
+
+        static const int stencil[4][2] = {{1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+        for (int k = 0; k < 4; k++) {
+            int c = column + stencil[k][0], r = row + stencil[k][1];
+            int b, e;
+
+            if (c >= 0 && c < grid->columns && r < grid->rows && gridCellRange(grid, c, r, &b, &e))
+                pairCells(sums, src, radius, cell, n, indices + b, e - b);
+        }
+
+        begin = cellEnd;
+    }
+}
+
+// symmetric step: distances are taken once per pair from the grid and
+// added to both boids, instead of once from each side. Rows are done in
+// two passes, even then odd, so no two threads write the same boid. Reads
+// the start of the step like a synchronous one, and has no neighbor cap.
+// One species only. Returns -1, having done nothing, when the grid or sums
+// cannot be built.
+static int updateSymmetric(Flock* flock, const Source* src, float* turn, const unsigned char* steps, double deltaTime) {
+    const Species* species = &flock->species[0];
+    const Grid* grid = flockGrid(flock);
+    PairSums* sums = flockPairs(flock);
+    if (!grid || !sums)
+        return -1;
+
+    TRACE_BEGIN("neighbor pairs");
+    #pragma omp parallel
+    {
+        #pragma omp for schedule(static)
+        for (int i = 0; i < flock->count; i++) {
+            sums->count[i] = 0;
+            sums->nearest[i] = -1;
+            sums->rotation[i] = sums->x[i] = sums->y[i] = 0;
+        }
+
+        for (int parity = 0; parity < 2; parity++) {
+            #pragma omp for schedule(dynamic)
+            for (int row = parity; row < grid->rows; row += 2)
+                pairRow(sums, src, grid, species->radius, row);
+        }
+    }
+    TRACE_END("neighbor pairs");
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < flock->count; i++) {
+        if (steps && !steps[i])
+            continue;
+
+        double dt = steps ? deltaTime * steps[i] : deltaTime;
+        float rotation = src->rotation[i];
+        float alignment = rotation, cohesion = rotation, separation = rotation;
+        float closestBoid = -1;
+        int count = sums->count[i];
+
+        if (count) {
+            int j = sums->nearest[i];
+
+            alignment = sums->rotation[i] / count;
+            cohesion = rotationTo(src->x[i], src->y[i], sums->x[i] / count, sums->y[i] / count);
+            closestBoid = sums->closest[i];
+
+            if (closestBoid <= species->flee)
+                separation = INVERSE(rotationTo(src->x[i], src->y[i], src->x[j], src->y[j]));
+        }
+
+        float maximumRotation = flock->angularVelocity[i] * dt;
+        turn[i] = steer(species, rotation, alignment, cohesion, separation, closestBoid, maximumRotation);
+    }
+
+    integrateColumns(flock, turn, steps, deltaTime);
+    return 0;
+}
+
+static int tileReserve(TileScratch* scratch, int boids, int cells) {
+    if (scratch->capacity < boids) {
+        int capacity = boids + boids / 2;
+        free(scratch->x);
+        scratch->x = malloc((size_t)capacity * (3 * sizeof(float) + sizeof(int)));
+        scratch->capacity = scratch->x ? capacity : 0;
+        if (!scratch->x)
+            return -1;
+        scratch->y = scratch->x + capacity;
+        scratch->rotation = scratch->y + capacity;
+        scratch->index = (int*)(scratch->rotation + capacity);
+    }
+
+    if (scratch->cells < cells + 1) {
+        free(scratch->cellStart);
+        scratch->cellStart = malloc((cells + 1) * sizeof(int));
+        scratch->cells = scratch->cellStart ? cells + 1 : 0;
+        if (!scratch->cellStart)
+            return -1;
+    }
+
+    return 0;
+}
+
+// gridNeighbors over the copy: cells around (column, row) of a copy
+// columns wide and rows high, merged by boid index, so the neighbors are
+// the ones a synchronous step finds, in the same order
+static int tileNeighbors(const TileScratch* scratch, int columns, int rows, int column, int row, int self, float radius, int cap, int* neighbors) {
+    const Source local = {scratch->x, scratch->y, scratch->rotation};
+    int begin[9], end[9], ranges = 0;
+
+    for (int r = row > 0 ? row - 1 : 0; r <= row + 1 && r < rows; r++) {
+        for (int c = column > 0 ? column - 1 : 0; c <= column + 1 && c < columns; c++) {
+            int cell = r * columns + c;
+            begin[ranges] = scratch->cellStart[cell];
+            end[ranges] = scratch->cellStart[cell + 1];
+            if (begin[ranges] < end[ranges])
+                ranges++;
+        }
+    }
+
+    int count = 0;
+
+    while (ranges && count < cap) {
+        int m = 0;
+        for (int k = 1; k < ranges; k++)
+            if (scratch->index[begin[k]] < scratch->index[begin[m]])
+                m = k;
+
+        int j = begin[m]++;
+        if (begin[m] == end[m]) {
+            ranges--;
+            begin[m] = begin[ranges];
+            end[m] = end[ranges];
+        }
+
+        if (j != self && distanceTo(&local, self, j) < radius)
+            neighbors[count++] = j;
+    }
+
+    return count;
+}
+
+// copies tile (tileColumn, tileRow) and a ring of one cell around it, then steps the
+// boids inside it from the copy. Without room for the copy they are
+// stepped from the shared columns instead. One species only.
+static void updateTile(Flock* flock, const Source* src, const Search* search, TileScratch* scratch, int tileColumn, int tileRow,
+                       float* turn, const unsigned char* steps, double deltaTime) {
+    const Species* species = &flock->species[0];
+    const Grid* grid = search->grid;
+    int size = flock->tileCells;
+    int c0 = tileColumn * size, r0 = tileRow * size;
+    int c1 = c0 + size < grid->columns ? c0 + size : grid->columns;
+    int r1 = r0 + size < grid->rows ? r0 + size : grid->rows;
+
+    int left = c0 > 0 ? c0 - 1 : 0, top = r0 > 0 ? r0 - 1 : 0;
+    int columns = (c1 < grid->columns ? c1 + 1 : c1) - left;
+    int rows = (r1 < grid->rows ? r1 + 1 : r1) - top;
+
+    TRACE_BEGIN("tile copy");
+    int boids = 0, begin, end;
+    for (int r = top; r < top + rows; r++) {
+        gridRowRange(grid, r, left, left + columns - 1, &begin, &end);
+        boids += end - begin;
+    }
+
+    if (tileReserve(scratch, boids, columns * rows)) {
+        TRACE_END("tile copy");
+        for (int r = r0; r < r1; r++) {
+            for (int c = c0; c < c1; c++) {
+                if (!gridCellRange(grid, c, r, &begin, &end))
+                    continue;
+                for (int k = begin; k < end; k++) {
+                    int i = grid->indices[k];
+                    if (!steps || steps[i])
+                        updateOne(flock, src, search, species, i, turn, steps ? deltaTime * steps[i] : deltaTime);
+                }
+            }
+        }
+        return;
+    }
+
+    int n = 0;
+    for (int r = 0; r < rows; r++) {
+        for (int c = 0; c < columns; c++) {
+            scratch->cellStart[r * columns + c] = n;
+            if (!gridCellRange(grid, left + c, top + r, &begin, &end))
+                continue;
+
+            for (int k = begin; k < end; k++, n++) {
+                int j = grid->indices[k];
+                scratch->x[n] = src->x[j];
+                scratch->y[n] = src->y[j];
+                scratch->rotation[n] = src->rotation[j];
+                scratch->index[n] = j;
+            }
+        }
+    }
+    scratch->cellStart[rows * columns] = n;
+    TRACE_END("tile copy");
+
+    const Source local = {scratch->x, scratch->y, scratch->rotation};
+    int neighbors[MAX_NEIGHBORS];
+
+    for (int r = r0 - top; r < r1 - top; r++) {
+        for (int c = c0 - left; c < c1 - left; c++) {
+            int cell = r * columns + c;
+
+            for (int k = scratch->cellStart[cell]; k < scratch->cellStart[cell + 1]; k++) {
+                int i = scratch->index[k];
+                if (steps && !steps[i])
+                    continue;
+
+                TRACE_BEGIN("neighbor search");
+                int count = tileNeighbors(scratch, columns, rows, c, r, k, species->radius, search->cap, neighbors);
+                TRACE_END("neighbor search");
+
+                applyRules(flock, &local, species, k, neighbors, count, i, turn, steps ? deltaTime * steps[i] : deltaTime);
+            }
+        }
+    }
+}
+
+static int compareTile(const void* a, const void* b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+// sparse grids can have far more tiles than boids, so only the tiles that
+// hold a boid are listed, by row-major tile number. -1 without memory.
+static int occupiedTiles(const Flock* flock, const Source* src, const Grid* grid, long long** out) {
+    int size = flock->tileCells;
+    long long across = (grid->columns + size - 1) / size;
+    long long* tiles = malloc((grid->count ? grid->count : 1) * sizeof(long long));
+    int count = 0;
+
+    if (!tiles)
+        return -1;
+
+    for (int k = 0; k < grid->count; k++) {
+        int i = grid->indices[k];
+        int c = (int)(src->x[i] / grid->cellSize), r = (int)(src->y[i] / grid->cellSize);
+        c = c < 0 ? 0 : c > grid->columns - 1 ? grid->columns - 1 : c;
+        r = r < 0 ? 0 : r > grid->rows - 1 ? grid->rows - 1 : r;
+
+        long long tile = r / size * across + c / size;
+        if (!count || tiles[count - 1] != tile)
+            tiles[count++] = tile;
+    }
+
+    qsort(tiles, count, sizeof(long long), compareTile);
+
+    int unique = 0;
+    for (int t = 0; t < count; t++)
+        if (!unique || tiles[unique - 1] != tiles[t])
+            tiles[unique++] = tiles[t];
+
+    *out = tiles;
+    return unique;
+}
+
+// tiled step: each thread takes square tiles of tileCells cells and works
+// from a private copy of the tile and its surroundings, which stays in
+// cache while the tile's boids read it over and over. Synchronous, and
+// gives the same bits as a synchronous step. Returns -1, having done
+// nothing, when the grid or the per-thread scratch cannot be set up.
+static int updateTiled(Flock* flock, const Source* src, const Search* search, float* turn, const unsigned char* steps, double deltaTime) {
+    if (!search->grid)
+        return -1;
+
+    int threads = omp_get_max_threads();
+    if (flock->tileThreads < threads) {
+        TileScratch* tiles = realloc(flock->tiles, threads * sizeof(TileScratch));
+        if (!tiles)
+            return -1;
+        memset(tiles + flock->tileThreads, 0, (threads - flock->tileThreads) * sizeof(TileScratch));
+        flock->tiles = tiles;
+        flock->tileThreads = threads;
+    }
+
+    const Grid* grid = search->grid;
+    int size = flock->tileCells;
+    int across = (grid->columns + size - 1) / size;
+    long long* occupied = NULL;
+    long long tiles = (long long)across * ((grid->rows + size - 1) / size);
+
+    if (grid->sparse && (tiles = occupiedTiles(flock, src, grid, &occupied)) < 0)
+        return -1;
+
+    #pragma omp parallel
+    {
+        // each thread grows and so first touches its own scratch
+        TileScratch* scratch = &flock->tiles[omp_get_thread_num()];
+
+        TRACE_BEGIN("boids");
+        #pragma omp for schedule(dynamic)
+        for (long long t = 0; t < tiles; t++) {
+            long long tile = occupied ? occupied[t] : t;
+            updateTile(flock, src, search, scratch, (int)(tile % across), (int)(tile / across), turn, steps, deltaTime);
+        }
+        TRACE_END("boids");
+    }
+
+    free(occupied);
+    integrateColumns(flock, turn, steps, deltaTime);
+    return 0;
+}
+
+void updateFlock(Flock* flock, double now) {
+    updateFlockActive(flock, now, NULL);
+}
+
+void updateFlockActive(Flock* flock, double now, const unsigned char* steps) {
+    // sort the bands back together before anything holds the columns, and
+    // not while steps is indexed by the old order
+    if (flock->placeInterval > 0 && !steps && ++flock->placeSteps >= flock->placeInterval) {
+        flock->placeSteps = 0;
+        flockPlace(flock, 1);
+    }
+
+    double deltaTime = now - flock->lastUpdate;
+    Source src = {flock->x, flock->y, flock->rotation};
+    Search search = {NULL, NULL, 0, MAX_NEIGHBORS};
+    float step = 0;
+
+    if (!flock->speciesCount)
+        speciesDefaults(flock);
+
+    if (flock->neighborCap > 0 && flock->neighborCap < MAX_NEIGHBORS)
+        search.cap = flock->neighborCap;
+
+    if (flock->synchronous || flock->symmetric || flock->tileCells > 0)
+        src = flockPrevious(flock);
+
+    // synchronous steps apply the rules first, then move everyone in one pass
+    float* turn = src.x != flock->x ? (float*)src.rotation + flockColumnStride(flock->count) / sizeof(float) : NULL;
+
+    if (flock->symmetric && flock->speciesCount == 1 && src.x != flock->x && updateSymmetric(flock, &src, turn, steps, deltaTime) == 0) {
+        if (flock->lists)
+            flock->lists->count = 0; // not kept up to date
+        flock->lastUpdate = now;
+        return;
+    }
+
+    if (flock->tileCells > 0 && flock->speciesCount == 1 && src.x != flock->x) {
+        search.grid = flockGrid(flock);
+        if (updateTiled(flock, &src, &search, turn, steps, deltaTime) == 0) {
+            if (flock->lists)
+                flock->lists->count = 0;
+            flock->lastUpdate = now;
+            return;
+        }
+    }
+
+    // the furthest a boid moves this step
+    if (src.x == flock->x || flock->reuseNeighbors) {
+        #pragma omp parallel for schedule(static) reduction(max:step)
+        for (int i = 0; i < flock->count; i++)
+            step = fmaxf(step, fmaxf(fabsf(flock->speedX[i]), fabsf(flock->speedY[i])) * deltaTime * (steps ? steps[i] : 1));
+    }
+
+    // in place, boids earlier in the loop may have moved toward this one
+    if (src.x == flock->x)
+        search.travel = step;
+
+    if (flock->reuseNeighbors)
+        search.lists = flockLists(flock, &src, search.cap, step);
+    else if (flock->lists)
+        flock->lists->count = 0;
+
+    if (!search.lists)
+        search.grid = flockGrid(flock);
+
+    #pragma omp parallel
+    {
+        TRACE_BEGIN("boids");
+
+        // run by run, each with the parameters of its species
+        for (int s = 0; s < flock->speciesCount; s++) {
+            const Species* species = &flock->species[s];
+            int first = flock->speciesStart[s], last = flock->speciesStart[s + 1];
+
+            // placed flocks keep every boid on the thread that first touched it
+            if (flock->placed) {
+                #pragma omp for schedule(static) nowait
+                for (int i = first; i < last; i++)
+                    if (!steps || steps[i])
+                        updateOne(flock, &src, &search, species, i, turn, steps ? deltaTime * steps[i] : deltaTime);
+            } else {
+                #pragma omp for schedule(dynamic) nowait
+                for (int i = first; i < last; i++)
+                    if (!steps || steps[i])
+                        updateOne(flock, &src, &search, species, i, turn, steps ? deltaTime * steps[i] : deltaTime);
+            }
+        }
+
+        TRACE_END("boids");
+
+        TRACE_BEGIN("barrier");
+        #pragma omp barrier
+        TRACE_END("barrier");
+    }
+
+    if (turn)
+        integrateColumns(flock, turn, steps, deltaTime);
+
+    flock->lastUpdate = now;
+}
@@ -0,0 +1,125 @@
+#pragma once
+#include <stddef.h>
+
+// Structure of arrays flock state, one column per boid attribute.
+//
+// Columns are 64-byte aligned and live in a single block, either allocated
+// by flockCreate or mapped straight from a snapshot file (snapshot.h).
+// Triangle vertices are not stored, they follow from rotation.
+// updateFlock keeps a spatial grid alongside, created on the first step.
+#define FLOCK_ALIGNMENT 64
+#define FLOCK_MAX_SPECIES 8
+#define FLOCK_PLACE_INTERVAL 128 // full steps between spatial re-sorts of a placed flock
+
+// how boids of one species treat neighbors of another
+typedef enum SpeciesInteraction {
+    SPECIES_FOLLOW, // counted by every rule, like their own kind
+    SPECIES_AVOID, // not flocked with, the nearest one is turned away from
+    SPECIES_IGNORE, // not seen
+} SpeciesInteraction;
+
+// rule parameters shared by every boid of a species. Of its neighbors
+// within radius, a boid steers by the closest: away from it nearer than
+// flee, separation rules nearer than separation, cohesion from cohesion on
+// and alignment in between.
+typedef struct Species {
+    float speed; // pixels per second along the heading
+    float angularVelocity; // radians per second
+    float radius;
+    float flee;
+    float separation;
+    float cohesion;
+    unsigned char interaction[FLOCK_MAX_SPECIES]; // SpeciesInteraction toward each species
+} Species;
+
+// the rules every boid followed before species, toward itself only
+#define SPECIES_DEFAULT {20, 1, 50, 5, 10, 30, {SPECIES_FOLLOW}}
+// a hunter for a second species: faster, sees further, always heads for
+// the middle of the species 0 boids it sees and ignores its own kind
+#define SPECIES_PREDATOR {30, 1.5f, 80, 0, 0, 0, {SPECIES_FOLLOW, SPECIES_IGNORE}}
+
+typedef struct Flock {
+    int count;
+    float width; // world size, positions wrap to [0, width) x [0, height)
+    float height;
+    double lastUpdate;
+
+    float* x;
+    float* y;
+    float* rotation; // radians, 0 points up
+    float* speedX; // pixels per second
+    float* speedY;
+    float* angularVelocity; // radians per second
+
+    void* storage; // allocation or mapping backing the columns
+    size_t storageSize;
+    int mapped;
+
+    struct Grid* grid; // neighbor index from the start of the last step that searched it (grid.h)
+
+    // synchronous steps read every neighbor as it was at the start of the
+    // step, so results do not depend on update order or thread count
+    int synchronous;
+    float* previous;
+    int previousCount;
+
+    // symmetric steps are synchronous, and visit each pair of neighboring
+    // grid cells once, taking each distance once for both boids. There is
+    // no neighbor cap, and sums add up in another order, so results differ
+    // slightly from a synchronous step.
+    int symmetric;
+    struct PairSums* pairs;
+
+    // tiled steps, when tileCells > 0, are synchronous and go tile by tile
+    // of tileCells x tileCells grid cells, each thread reading from its own
+    // copy of the tile and the cells around it. Same results as a
+    // synchronous step, with neighbor reads kept in cache.
+    int tileCells;
+    struct TileScratch* tiles; // one per thread
+    int tileThreads;
+
+    int placed; // set by flockPlace, steps use a static schedule
+    // boids drift out of their thread's band as they move, so a spatially
+    // placed flock is placed again every placeInterval full steps (0 never)
+    int placeInterval;
+    int placeSteps;
+
+    // boids are grouped by species: species s is the run of boids
+    // [speciesStart[s], speciesStart[s + 1]), and steps go run by run with
+    // one set of parameters each. Mixed flocks take the synchronous path
+    // in place of symmetric or tiled steps. A flock that was never split
+    // is one default species.
+    int speciesCount;
+    Species species[FLOCK_MAX_SPECIES];
+    int speciesStart[FLOCK_MAX_SPECIES + 1];
+
+    // accuracy traded for time under load (budget.h)
+    int neighborCap; // neighbors each boid follows, 0 for the full 128
+    int reuseNeighbors; // keep neighbor lists with a skin across steps instead of searching the grid each step
+    struct NeighborLists* lists;
+} Flock;
+
+int flockCreate(Flock* flock, int count, float width, float height);
+void flockDestroy(Flock* flock);
+// moves the columns into fresh memory first touched by the OpenMP thread
+// that steps each boid (bind threads first, numa.h), optionally reordered
+// so each thread's boids are one band of the world. Boid indices change,
+// and with spatial order change again every FLOCK_PLACE_INTERVAL steps.
+int flockPlace(Flock* flock, int spatial);
+size_t flockColumnStride(int count); // bytes per column including padding
+
+void flockSetBoid(Flock* flock, int i, float x, float y, float rotation, float speedX, float speedY, float angularVelocity);
+void flockTriangle(const Flock* flock, int i, float out[6]); // world space vertices
+
+// species s takes the next counts[s] boids by index, which must add up to
+// the whole flock, and sets their speed and angular velocity. -1 for a bad
+// split or parameters, leaving the flock as it was.
+int flockSetSpecies(Flock* flock, const Species* species, const int* counts, int speciesCount);
+// the same split, keeping every boid's speed and angular velocity
+int flockGroupSpecies(Flock* flock, const Species* species, const int* counts, int speciesCount);
+int flockSpeciesOf(const Flock* flock, int i);
+
+void updateFlock(Flock* flock, double now);
+// boid i advances steps[i] times the time since the last update, 0 leaves
+// it where it is. NULL advances every boid once.
+void updateFlockActive(Flock* flock, double now, const unsigned char* steps);
@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "framering.h"
+
+#define COLUMNS 3
+
+typedef struct RingHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t slots;
+    uint32_t capacity;
+    float width;
+    float height;
+    uint32_t writerPid;
+    uint64_t slotSize;
+    _Atomic uint64_t latest; // newest complete frame + 1, 0 before the first one
+    _Atomic uint32_t alive;
+} RingHeader;
+
+typedef struct RingSlot {
+    _Atomic uint64_t sequence; // odd while being written
+    uint64_t frame;
+    double time;
+    uint32_t count;
+} RingSlot;
+
+_Static_assert(sizeof(RingHeader) <= FLOCK_ALIGNMENT, "ring header must fit one cache line");
+_Static_assert(sizeof(RingSlot) <= FLOCK_ALIGNMENT, "slot header must fit one cache line");
+_Static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared counters must be lock free");
+
+struct FrameRing {
+    char name[256];
+    uint8_t* base;
+    size_t size;
+    size_t stride; // bytes per column
+    int writer;
+
+    // reader side
+    uint64_t lastFrame;
+    RingSlot* acquired;
+    uint64_t acquiredSequence;
+};
+
+static RingHeader* header(const FrameRing* ring) {
+    return (RingHeader*)ring->base;
+}
+
+static RingSlot* slot(const FrameRing* ring, uint64_t frame) {
+    const RingHeader* h = header(ring);
+    return (RingSlot*)(ring->base + FLOCK_ALIGNMENT + (frame % h->slots) * h->slotSize);
+}
+
+static float* column(const RingSlot* s, size_t stride, int c) {
+    return (float*)((uint8_t*)s + FLOCK_ALIGNMENT + c * stride);
+}
+
+FrameRing* frameRingCreate(const char* name, int capacity, float width, float height) {
+    FrameRing* ring = calloc(1, sizeof(FrameRing));
+    if (!ring)
+        return NULL;
+
+    snprintf(ring->name, sizeof(ring->name), "%s", name);
+    ring->stride = flockColumnStride(capacity);
+    ring->writer = 1;
+
+    uint64_t slotSize = FLOCK_ALIGNMENT + COLUMNS * ring->stride;
+    ring->size = FLOCK_ALIGNMENT + FRAMERING_SLOTS * slotSize;
+
+    int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, 0) != 0 || ftruncate(fd, ring->size) != 0) {
+        fprintf(stderr, "framering: cannot create %s\n", name);
+        if (fd >= 0)
+            close(fd);
+        free(ring);
+        return NULL;
+    }
+
+    ring->base = mmap(NULL, ring->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ring->base == MAP_FAILED) {
+        fprintf(stderr, "framering: cannot map %s\n", name);
+        shm_unlink(name);
+        free(ring);
+        return NULL;
+    }
+
+    RingHeader* h = header(ring);
+    h->version = FRAMERING_VERSION;
+    h->slots = FRAMERING_SLOTS;
+    h->capacity = capacity;
+    h->width = width;
+    h->height = height;
+    h->writerPid = (uint32_t)getpid();
+    h->slotSize = slotSize;
+    atomic_store(&h->latest, 0);
+    atomic_store(&h->alive, 1);
+
+    // viewers check the magic, so it goes in last
+    atomic_thread_fence(memory_order_release);
+    memcpy(h->magic, FRAMERING_MAGIC, sizeof(h->magic));
+
+    return ring;
+}
+
+void frameRingPublish(FrameRing* ring, const Flock* flock, uint64_t frame) {
+    RingHeader* h = header(ring);
+    RingSlot* s = slot(ring, frame);
+    uint32_t count = flock->count < (int)h->capacity ? (uint32_t)flock->count : h->capacity;
+    uint64_t sequence = atomic_load_explicit(&s->sequence, memory_order_relaxed);
+
+    atomic_store_explicit(&s->sequence, sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    s->frame = frame;
+    s->time = flock->lastUpdate;
+    s->count = count;
+    memcpy(column(s, ring->stride, 0), flock->x, count * sizeof(float));
+    memcpy(column(s, ring->stride, 1), flock->y, count * sizeof(float));
+    memcpy(column(s, ring->stride, 2), flock->rotation, count * sizeof(float));
+
+    atomic_store_explicit(&s->sequence, sequence + 2, memory_order_release);
+    atomic_store_explicit(&h->latest, frame + 1, memory_order_release);
+}
+
+FrameRing* frameRingAttach(const char* name) {
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < FLOCK_ALIGNMENT) {
+        close(fd);
+        return NULL;
+    }
+
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return NULL;
+
+    const RingHeader* h = base;
+    if (memcmp(h->magic, FRAMERING_MAGIC, sizeof(h->magic)) || h->version != FRAMERING_VERSION
+        || !h->slots || FLOCK_ALIGNMENT + h->slots * h->slotSize > (uint64_t)st.st_size
+        || h->slotSize < FLOCK_ALIGNMENT + COLUMNS * flockColumnStride(h->capacity)) {
+        munmap(base, st.st_size);
+        return NULL;
+    }
+
+    FrameRing* ring = calloc(1, sizeof(FrameRing));
+    if (!ring) {
+        munmap(base, st.st_size);
+        return NULL;
+    }
+
+    snprintf(ring->name, sizeof(ring->name), "%s", name);
+    ring->base = base;
+    ring->size = st.st_size;
+    ring->stride = flockColumnStride(h->capacity);
+    ring->lastFrame = UINT64_MAX;
+
+    return ring;
+}
+
+int frameRingAcquire(FrameRing* ring, Flock* view, uint64_t* frame) {
+    const RingHeader* h = header(ring);
+    uint64_t latest = atomic_load_explicit(&h->latest, memory_order_acquire);
+
+    if (!latest || latest - 1 == ring->lastFrame)
+        return 1;
+
+    RingSlot* s = slot(ring, latest - 1);
+    uint64_t sequence = atomic_load_explicit(&s->sequence, memory_order_acquire);
+
+    // the writer lapped the ring and is already refilling this slot
+    if ((sequence & 1) || s->frame != latest - 1)
+        return -1;
+
+    memset(view, 0, sizeof(*view));
+    view->count = s->count < h->capacity ? (int)s->count : (int)h->capacity;
+    view->width = h->width;
+    view->height = h->height;
+    view->lastUpdate = s->time;
+
+    // read only mapping, the view must not be stepped or destroyed
+    view->x = column(s, ring->stride, 0);
+    view->y = column(s, ring->stride, 1);
+    view->rotation = column(s, ring->stride, 2);
+
+    ring->acquired = s;
+    ring->acquiredSequence = sequence;
+    ring->lastFrame = latest - 1;
+    *frame = latest - 1;
+
+    return 0;
+}
+
+int frameRingRetain(FrameRing* ring) {
+    const RingHeader* h = header(ring);
+    if (!atomic_load_explicit(&h->latest, memory_order_acquire))
+        return -1;
+
+    RingSlot* s = slot(ring, ring->lastFrame);
+    uint64_t sequence = atomic_load_explicit(&s->sequence, memory_order_acquire);
+
+    // already refilled or being refilled with a newer frame
+    if ((sequence & 1) || s->frame != ring->lastFrame)
+        return -1;
+
+    ring->acquired = s;
+    ring->acquiredSequence = sequence;
+
+    return 0;
+}
+
+int frameRingRelease(FrameRing* ring) {
+    if (!ring->acquired)
+        return -1;
+
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t sequence = atomic_load_explicit(&ring->acquired->sequence, memory_order_relaxed);
+    ring->acquired = NULL;
+
+    return sequence == ring->acquiredSequence ? 0 : -1;
+}
+
+int frameRingWriterAlive(const FrameRing* ring) {
+    return atomic_load_explicit(&header(ring)->alive, memory_order_relaxed) != 0;
+}
+
+void frameRingClose(FrameRing* ring) {
+    if (!ring)
+        return;
+
+    if (ring->writer) {
+        atomic_store(&header(ring)->alive, 0);
+        shm_unlink(ring->name);
+    }
+
+    munmap(ring->base, ring->size);
+    free(ring);
+}
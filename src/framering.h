@@ -0,0 +1,31 @@
+#pragma once
+#include <stdint.h>
+#include "flock.h"
+
+// POSIX shared memory ring of recent flock frames, one writer and any
+// number of read-only viewers.
+//
+// Each slot holds x, y and rotation columns guarded by a seqlock counter:
+// odd while the writer is inside, bumped to the next even value when done.
+// The writer also publishes the newest complete frame number. Viewers map
+// the slot directly (no copy), draw from it, then check the counter did not
+// move to detect frames overwritten while in use. Anything older than the
+// newest frame is skipped. Redrawing a frame while no newer one is ready
+// goes through frameRingRetain and frameRingRelease the same way.
+#define FRAMERING_MAGIC "BOIDRING"
+#define FRAMERING_VERSION 1
+#define FRAMERING_SLOTS 4
+#define FRAMERING_DEFAULT_NAME "/boids"
+
+typedef struct FrameRing FrameRing;
+
+FrameRing* frameRingCreate(const char* name, int capacity, float width, float height);
+void frameRingPublish(FrameRing* ring, const Flock* flock, uint64_t frame);
+
+FrameRing* frameRingAttach(const char* name);
+int frameRingAcquire(FrameRing* ring, Flock* view, uint64_t* frame); // 0 new frame, 1 nothing newer, -1 writer mid-update
+int frameRingRetain(FrameRing* ring); // guard the last acquired frame again to redraw it, -1 if it is gone
+int frameRingRelease(FrameRing* ring); // 0 if the acquired or retained frame stayed intact
+int frameRingWriterAlive(const FrameRing* ring);
+
+void frameRingClose(FrameRing* ring); // the writer also unlinks the segment
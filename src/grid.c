@@ -0,0 +1,296 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "grid.h"
+
+#define SPARSE_RATIO 4 // go sparse past this many cells per boid
+#define RADIX_BITS 8
+#define RADIX (1 << RADIX_BITS)
+
+static int compareInt(const void* a, const void* b) {
+    return *(const int*)a - *(const int*)b;
+}
+
+static int clampInt(int v, int lo, int hi) {
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+static uint64_t cellKey(const Grid* grid, int column, int row) {
+    return (uint64_t)row * grid->columns + column;
+}
+
+static size_t hashKey(uint64_t key) {
+    return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 17);
+}
+
+int gridInit(Grid* grid, float width, float height, float cellSize, int count, GridMode mode) {
+    memset(grid, 0, sizeof(*grid));
+
+    grid->cellSize = cellSize;
+    grid->columns = (int)ceilf(width / cellSize);
+    grid->rows = (int)ceilf(height / cellSize);
+    if (grid->columns < 1)
+        grid->columns = 1;
+    if (grid->rows < 1)
+        grid->rows = 1;
+
+    double cells = (double)grid->columns * grid->rows;
+    grid->sparse = mode == GRID_SPARSE
+        || (mode == GRID_AUTO && cells > (double)SPARSE_RATIO * (count > 0 ? count : 1))
+        || cells >= INT32_MAX;
+    if (grid->sparse)
+        return 0;
+
+    grid->cellStart = calloc((size_t)cells + 1, sizeof(int));
+    if (!grid->cellStart) {
+        fprintf(stderr, "grid: cannot allocate %dx%d cells\n", grid->columns, grid->rows);
+        return -1;
+    }
+
+    return 0;
+}
+
+void gridFree(Grid* grid) {
+    free(grid->cellStart);
+    free(grid->indices);
+    free(grid->cellOf);
+    free(grid->keys);
+    free(grid->scratchKeys);
+    free(grid->scratchIndices);
+    free(grid->table);
+    memset(grid, 0, sizeof(*grid));
+}
+
+size_t gridBytes(const Grid* grid) {
+    size_t perBoid = grid->sparse ? 2 * (sizeof(int) + sizeof(uint64_t)) : 2 * sizeof(int);
+    size_t cells = grid->sparse ? grid->tableSize * sizeof(GridSlot)
+        : ((size_t)grid->columns * grid->rows + 1) * sizeof(int);
+    return cells + (size_t)grid->capacity * perBoid;
+}
+
+void gridCellRect(const Grid* grid, float x0, float y0, float x1, float y1, int* c0, int* r0, int* c1, int* r1) {
+    *c0 = clampInt((int)floorf(x0 / grid->cellSize), 0, grid->columns - 1);
+    *r0 = clampInt((int)floorf(y0 / grid->cellSize), 0, grid->rows - 1);
+    *c1 = clampInt((int)floorf(x1 / grid->cellSize), 0, grid->columns - 1);
+    *r1 = clampInt((int)floorf(y1 / grid->cellSize), 0, grid->rows - 1);
+}
+
+int gridCellRange(const Grid* grid, int column, int row, int* begin, int* end) {
+    if (!grid->sparse) {
+        int cell = row * grid->columns + column;
+        *begin = grid->cellStart[cell];
+        *end = grid->cellStart[cell + 1];
+        return *end - *begin;
+    }
+
+    uint64_t key = cellKey(grid, column, row);
+    size_t mask = grid->tableSize - 1;
+
+    for (size_t s = hashKey(key) & mask;; s = (s + 1) & mask) {
+        const GridSlot* slot = &grid->table[s];
+        if (slot->key == key) {
+            *begin = slot->begin;
+            *end = slot->end;
+            return *end - *begin;
+        }
+        if (slot->key == GRID_EMPTY) {
+            *begin = *end = 0;
+            return 0;
+        }
+    }
+}
+
+// first entry whose cell key is at least key
+static int lowerBound(const Grid* grid, uint64_t key) {
+    int lo = 0, hi = grid->count;
+
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (grid->keys[mid] < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+void gridRowRange(const Grid* grid, int row, int c0, int c1, int* begin, int* end) {
+    if (!grid->sparse) {
+        *begin = grid->cellStart[row * grid->columns + c0];
+        *end = grid->cellStart[row * grid->columns + c1 + 1];
+        return;
+    }
+
+    // cells of a row are adjacent in key order
+    *begin = lowerBound(grid, cellKey(grid, c0, row));
+    *end = lowerBound(grid, cellKey(grid, c1, row) + 1);
+}
+
+static int reserve(void** p, size_t size) {
+    void* q = realloc(*p, size);
+    if (q)
+        *p = q;
+    return q ? 0 : -1;
+}
+
+static int buildDense(Grid* grid, const Flock* flock) {
+    int count = flock->count;
+    int cells = grid->columns * grid->rows;
+    int* start = grid->cellStart;
+    int* cellOf = grid->cellOf;
+    int* indices = grid->indices;
+
+    memset(start, 0, (cells + 1) * sizeof(int));
+
+    #pragma omp parallel
+    {
+        // count, shifted by one so the prefix sum lands on cell starts
+        #pragma omp for schedule(static)
+        for (int i = 0; i < count; i++) {
+            int c = clampInt((int)(flock->x[i] / grid->cellSize), 0, grid->columns - 1)
+                + clampInt((int)(flock->y[i] / grid->cellSize), 0, grid->rows - 1) * grid->columns;
+            cellOf[i] = c;
+
+            #pragma omp atomic update
+            start[c + 1]++;
+        }
+
+        #pragma omp single
+        for (int c = 0; c < cells; c++)
+            start[c + 1] += start[c];
+
+        // start doubles as the fill cursor, ending up one cell ahead
+        #pragma omp for schedule(static)
+        for (int i = 0; i < count; i++) {
+            int slot;
+            #pragma omp atomic capture
+            slot = start[cellOf[i]]++;
+            indices[slot] = i;
+        }
+
+        #pragma omp single
+        {
+            for (int c = cells; c > 0; c--)
+                start[c] = start[c - 1];
+            start[0] = 0;
+        }
+
+        // threads filled cells concurrently, restore index order
+        #pragma omp for schedule(dynamic, 256)
+        for (int c = 0; c < cells; c++) {
+            if (start[c + 1] - start[c] > 64) {
+                qsort(indices + start[c], start[c + 1] - start[c], sizeof(int), compareInt);
+                continue;
+            }
+
+            for (int a = start[c] + 1; a < start[c + 1]; a++) {
+                int v = indices[a], b = a - 1;
+                for (; b >= start[c] && indices[b] > v; b--)
+                    indices[b + 1] = indices[b];
+                indices[b + 1] = v;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int buildSparse(Grid* grid, const Flock* flock) {
+    int count = flock->count;
+    uint64_t* keys = grid->keys;
+    int* indices = grid->indices;
+    uint64_t* otherKeys = grid->scratchKeys;
+    int* otherIndices = grid->scratchIndices;
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < count; i++) {
+        int c = clampInt((int)(flock->x[i] / grid->cellSize), 0, grid->columns - 1);
+        int r = clampInt((int)(flock->y[i] / grid->cellSize), 0, grid->rows - 1);
+        keys[i] = cellKey(grid, c, r);
+        indices[i] = i;
+    }
+
+    // stable LSD radix sort keeps indices ascending within a cell
+    uint64_t maxKey = (uint64_t)grid->columns * grid->rows;
+    for (int shift = 0; shift < 64 && (maxKey >> shift); shift += RADIX_BITS) {
+        int offsets[RADIX] = {0};
+
+        for (int i = 0; i < count; i++)
+            offsets[(keys[i] >> shift) & (RADIX - 1)]++;
+        for (int d = 0, sum = 0; d < RADIX; d++) {
+            int n = offsets[d];
+            offsets[d] = sum;
+            sum += n;
+        }
+        for (int i = 0; i < count; i++) {
+            int slot = offsets[(keys[i] >> shift) & (RADIX - 1)]++;
+            otherKeys[slot] = keys[i];
+            otherIndices[slot] = indices[i];
+        }
+
+        uint64_t* k = keys; keys = otherKeys; otherKeys = k;
+        int* x = indices; indices = otherIndices; otherIndices = x;
+    }
+
+    grid->keys = keys;
+    grid->indices = indices;
+    grid->scratchKeys = otherKeys;
+    grid->scratchIndices = otherIndices;
+
+    int occupied = 0;
+    for (int i = 0; i < count; i++)
+        occupied += !i || keys[i] != keys[i - 1];
+
+    // at most half full keeps probe chains short
+    size_t tableSize = 16;
+    while (tableSize < 2 * (size_t)occupied)
+        tableSize *= 2;
+    if (tableSize != grid->tableSize) {
+        if (reserve((void**)&grid->table, tableSize * sizeof(GridSlot)))
+            return -1;
+        grid->tableSize = tableSize;
+    }
+
+    size_t mask = tableSize - 1;
+    for (size_t s = 0; s < tableSize; s++)
+        grid->table[s].key = GRID_EMPTY;
+
+    for (int begin = 0, end; begin < count; begin = end) {
+        for (end = begin + 1; end < count && keys[end] == keys[begin]; end++)
+            ;
+
+        size_t s = hashKey(keys[begin]) & mask;
+        while (grid->table[s].key != GRID_EMPTY)
+            s = (s + 1) & mask;
+        grid->table[s] = (GridSlot){keys[begin], begin, end};
+    }
+
+    grid->occupied = occupied;
+    return 0;
+}
+
+int gridBuild(Grid* grid, const Flock* flock) {
+    int count = flock->count;
+
+    if (count > grid->capacity) {
+        int ok = reserve((void**)&grid->indices, count * sizeof(int)) == 0;
+        if (grid->sparse) {
+            ok = ok && reserve((void**)&grid->keys, count * sizeof(uint64_t)) == 0;
+            ok = ok && reserve((void**)&grid->scratchKeys, count * sizeof(uint64_t)) == 0;
+            ok = ok && reserve((void**)&grid->scratchIndices, count * sizeof(int)) == 0;
+        } else
+            ok = ok && reserve((void**)&grid->cellOf, count * sizeof(int)) == 0;
+        if (!ok)
+            return -1;
+        grid->capacity = count;
+    }
+
+    grid->count = 0;
+    int result = grid->sparse ? buildSparse(grid, flock) : buildDense(grid, flock);
+    grid->count = result ? 0 : count;
+
+    return result;
+}
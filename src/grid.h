@@ -0,0 +1,64 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "flock.h"
+
+// Uniform grid over the world, rebuilt from scratch every step.
+//
+// Boids are bucketed by cell: `indices` lists boid indices cell after cell
+// in row-major cell order, ascending within a cell, so merging the cells
+// around a boid visits candidates in the same order as a scan over the
+// whole flock.
+//
+// Dense grids keep a start offset for every cell, filled by a counting
+// sort. When most cells would be empty (a world far larger than the flock
+// needs) the grid goes sparse instead. Boids are radix sorted by cell key,
+// and an open-addressing table maps each occupied cell to its range, so
+// memory follows the occupied area rather than the world size.
+typedef enum GridMode {
+    GRID_AUTO,
+    GRID_DENSE,
+    GRID_SPARSE,
+} GridMode;
+
+typedef struct GridSlot {
+    uint64_t key; // GRID_EMPTY when unused
+    int begin;
+    int end;
+} GridSlot;
+
+#define GRID_EMPTY UINT64_MAX
+
+typedef struct Grid {
+    float cellSize;
+    int columns;
+    int rows;
+    int sparse;
+    int count; // boids indexed
+    int capacity;
+
+    int* indices; // by cell
+
+    // dense
+    int* cellStart; // columns * rows + 1
+    int* cellOf; // per boid
+
+    // sparse
+    uint64_t* keys; // cell key of each entry of indices
+    uint64_t* scratchKeys;
+    int* scratchIndices;
+    GridSlot* table;
+    size_t tableSize; // power of two
+    int occupied;
+} Grid;
+
+int gridInit(Grid* grid, float width, float height, float cellSize, int count, GridMode mode);
+int gridBuild(Grid* grid, const Flock* flock);
+void gridFree(Grid* grid);
+size_t gridBytes(const Grid* grid);
+
+// clamped cell rectangle covering [x0, x1] x [y0, y1], inclusive
+void gridCellRect(const Grid* grid, float x0, float y0, float x1, float y1, int* c0, int* r0, int* c1, int* r1);
+// range of indices in one cell, or in columns c0..c1 of one row
+int gridCellRange(const Grid* grid, int column, int row, int* begin, int* end);
+void gridRowRange(const Grid* grid, int row, int c0, int c1, int* begin, int* end);
@@ -0,0 +1,107 @@
+#include <string.h>
+
+#include "histogram.h"
+
+#define HALF_SUB_BUCKETS (HISTOGRAM_SUB_BUCKETS / 2)
+#define MAX_VALUE ((UINT64_C(1) << HISTOGRAM_MAX_BITS) - 1)
+
+static int bucketIndex(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS)
+        return (int)value;
+
+    // the top HISTOGRAM_SUB_BUCKET_BITS bits select the sub bucket
+    int shift = 63 - __builtin_clzll(value) - (HISTOGRAM_SUB_BUCKET_BITS - 1);
+    return shift * HALF_SUB_BUCKETS + (int)(value >> shift);
+}
+
+// highest value that lands in the same bucket
+static uint64_t bucketValue(int index) {
+    if (index < HISTOGRAM_SUB_BUCKETS)
+        return (uint64_t)index;
+
+    int shift = index / HALF_SUB_BUCKETS - 1;
+    uint64_t subBucket = (uint64_t)(index - shift * HALF_SUB_BUCKETS);
+    return (subBucket << shift) + (UINT64_C(1) << shift) - 1;
+}
+
+void histogramReset(LatencyHistogram* hist) {
+    memset(hist, 0, sizeof(*hist));
+    hist->min = UINT64_MAX;
+}
+
+void histogramRecord(LatencyHistogram* hist, double seconds, int frame) {
+    uint64_t value = seconds > 0 ? (uint64_t)(seconds * 1e9) : 0;
+    if (value > MAX_VALUE)
+        value = MAX_VALUE;
+
+    hist->counts[bucketIndex(value)]++;
+    hist->total++;
+    hist->sum += (double)value;
+
+    if (value < hist->min)
+        hist->min = value;
+    if (value > hist->max)
+        hist->max = value;
+
+    // keep the slowest frames, insertion sorted
+    if (hist->worstCount == HISTOGRAM_WORST && value <= hist->worst[HISTOGRAM_WORST - 1].value)
+        return;
+
+    int i = hist->worstCount < HISTOGRAM_WORST ? hist->worstCount++ : HISTOGRAM_WORST - 1;
+    while (i > 0 && hist->worst[i - 1].value < value) {
+        hist->worst[i] = hist->worst[i - 1];
+        i--;
+    }
+    hist->worst[i] = (WorstFrame){value, frame};
+}
+
+double histogramPercentile(const LatencyHistogram* hist, double percentile) {
+    if (!hist->total)
+        return 0.0;
+
+    uint64_t target = (uint64_t)(percentile / 100.0 * hist->total + 0.5);
+    if (target < 1)
+        target = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += hist->counts[i];
+        if (seen >= target) {
+            uint64_t value = bucketValue(i);
+            if (value > hist->max)
+                value = hist->max;
+            return value / 1e6;
+        }
+    }
+
+    return hist->max / 1e6;
+}
+
+double histogramMean(const LatencyHistogram* hist) {
+    return hist->total ? hist->sum / hist->total / 1e6 : 0.0;
+}
+
+void histogramPrintHeader(FILE* fp) {
+    fprintf(fp, "%-8s | %9s | %9s | %9s | %9s | %9s | %9s | %9s\n",
+            "Phase", "min (ms)", "mean", "p50", "p95", "p99", "p99.9", "max");
+}
+
+void histogramPrint(const LatencyHistogram* hist, const char* name, FILE* fp) {
+    fprintf(fp, "%-8s | %9.3f | %9.3f | %9.3f | %9.3f | %9.3f | %9.3f | %9.3f\n",
+            name,
+            hist->total ? hist->min / 1e6 : 0.0,
+            histogramMean(hist),
+            histogramPercentile(hist, 50.0),
+            histogramPercentile(hist, 95.0),
+            histogramPercentile(hist, 99.0),
+            histogramPercentile(hist, 99.9),
+            hist->max / 1e6);
+}
+
+void histogramPrintWorst(const LatencyHistogram* hist, const char* name, FILE* fp) {
+    fprintf(fp, "%-8s worst:", name);
+    for (int i = 0; i < hist->worstCount; i++)
+        fprintf(fp, " #%d %.3f ms%s", hist->worst[i].frame, hist->worst[i].value / 1e6,
+                i + 1 < hist->worstCount ? "," : "");
+    fprintf(fp, "\n");
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+#include <stdio.h>
+
+// Log-linear (HDR style) latency histogram. Values are recorded in
+// nanoseconds with 1/64 relative precision up to 2^40 ns (about 18 minutes).
+// Storage is fixed size so recording never allocates.
+#define HISTOGRAM_SUB_BUCKET_BITS 7
+#define HISTOGRAM_SUB_BUCKETS (1 << HISTOGRAM_SUB_BUCKET_BITS)
+#define HISTOGRAM_MAX_BITS 40
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BUCKET_BITS + 2) * (HISTOGRAM_SUB_BUCKETS / 2))
+#define HISTOGRAM_WORST 8
+
+typedef struct WorstFrame {
+    uint64_t value; // ns
+    int frame;
+} WorstFrame;
+
+typedef struct LatencyHistogram {
+    uint32_t counts[HISTOGRAM_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    double sum; // ns
+    WorstFrame worst[HISTOGRAM_WORST]; // sorted, slowest first
+    int worstCount;
+} LatencyHistogram;
+
+void histogramReset(LatencyHistogram* hist);
+void histogramRecord(LatencyHistogram* hist, double seconds, int frame);
+double histogramPercentile(const LatencyHistogram* hist, double percentile); // ms
+double histogramMean(const LatencyHistogram* hist); // ms
+void histogramPrintHeader(FILE* fp);
+void histogramPrint(const LatencyHistogram* hist, const char* name, FILE* fp);
+void histogramPrintWorst(const LatencyHistogram* hist, const char* name, FILE* fp);
@@ -7,6 +7,15 @@
 
 #define TITLE "Boids Example"
 
+static void drawBoid(const Boid* boid) {
+	Vector2 screenPositions[3];
+
+	for (int i = 0; i < 3; i++)
+		screenPositions[i] = (Vector2){boid->positions[i].x + boid->origin.x, boid->positions[i].y + boid->origin.y};
+
+	DrawTriangle(screenPositions[0], screenPositions[1], screenPositions[2], BLUE);
+}
+
 int main(int argc, char* argv[]) {
 	InitWindow(WIDTH, HEIGHT, TITLE);
 	rlDisableBackfaceCulling();
@@ -22,7 +31,7 @@ int main(int argc, char* argv[]) {
 	Boid* flock[BOIDS];
 
 	for (int i = 0; i < BOIDS; i++)
-		flock[i] = newBoid((Vector2){GetRandomValue(0, WIDTH), GetRandomValue(0, HEIGHT)}, (Vector2){20, 20}, GetRandomValue(0, 6), 1);
+		flock[i] = newBoid((BoidVec2){GetRandomValue(0, WIDTH), GetRandomValue(0, HEIGHT)}, (BoidVec2){20, 20}, GetRandomValue(0, 6), 1);
 
 	while (!WindowShouldClose()){
 		for (int i = 0; i < BOIDS; i++)
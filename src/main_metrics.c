@@ -1,9 +1,13 @@
 #include <raylib.h>
 #include <rlgl.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdio.h>
+#include <math.h>
 #include <omp.h>
 #include "boids.h"
+#include "histogram.h"
+#include "trace.h"
 
 #define FPS 60
 #define WIDTH 1920
@@ -11,12 +15,48 @@
 #define TITLE "Boids Performance Metrics"
 #define BOIDS 5000
 #define BENCHMARK_FRAMES 100
+#define MAX_CATCH_UP 5 // steps per frame before the simulation falls behind real time
+
+// metrics_parallel steps with the OpenMP stepper unless told otherwise
+#ifdef UPDATE_ALL_BOIDS
+#define DEFAULT_STEPPER BOID_STEPPER_PARALLEL
+#else
+#define DEFAULT_STEPPER BOID_STEPPER_SERIAL
+#endif
 
 typedef struct {
     Vector2 v0, v1, v2;
 } Triangle;
 
-int main(void) {
+// per-phase frame latency, static so the hot loop never allocates
+static LatencyHistogram updateHist, computeHist, renderHist, frameHist;
+
+// state before each boid's last step, drawing blends from it to the current one
+static BoidVec2 previousOrigin[BOIDS];
+static float previousRotation[BOIDS];
+static double previousTime[BOIDS];
+
+// shortest signed difference, for positions that wrapped and angles past 2pi
+static float wrapDelta(float d, float period) {
+    return d - period * roundf(d / period);
+}
+
+int main(int argc, char* argv[]) {
+
+    // the simulation steps at a fixed rate, frames draw between the last two steps
+    int simRate = argc > 1 ? atoi(argv[1]) : FPS;
+    if (simRate <= 0)
+        simRate = FPS;
+    double simStep = 1.0 / simRate;
+
+    // each step advances one of this many interleaved slices of the flock
+    int slices = argc > 2 ? atoi(argv[2]) : 1;
+    if (slices < 1)
+        slices = 1;
+
+    BoidStepper stepper = DEFAULT_STEPPER;
+    if (argc > 3)
+        stepper = !strcmp(argv[3], "serial") ? BOID_STEPPER_SERIAL : BOID_STEPPER_PARALLEL;
 
     // Print thread info
     #ifdef _OPENMP
@@ -25,6 +65,8 @@ int main(void) {
         printf("OpenMP not enabled\n");
     #endif
 
+    TRACE_INIT();
+
     InitWindow(WIDTH, HEIGHT, TITLE);
     rlDisableBackfaceCulling();
     SetTargetFPS(FPS);
@@ -35,8 +77,8 @@ int main(void) {
     // Init boids
     for (int i = 0; i < BOIDS; i++) {
         flock[i] = newBoid(
-            (Vector2){GetRandomValue(0, WIDTH), GetRandomValue(0, HEIGHT) },
-            (Vector2){20, 20 },
+            (BoidVec2){GetRandomValue(0, WIDTH), GetRandomValue(0, HEIGHT) },
+            (BoidVec2){20, 20 },
             GetRandomValue(0, 6), 1);
     }
 
@@ -48,48 +90,117 @@ int main(void) {
     double start = GetTime();
     double lastUpdate = GetTime();
 
+    // every boid starts on the simulation clock
+    double simTime = GetTime();
+    double lastFrame = simTime;
+    double accumulator = 0.0;
+    int steps = 0;
+    long boidSteps = 0;
+    double avgBoidRate = 0.0;
+
+    for (int i = 0; i < BOIDS; i++) {
+        flock[i]->lastUpdate = simTime;
+        previousOrigin[i] = flock[i]->origin;
+        previousRotation[i] = flock[i]->rotation;
+        previousTime[i] = simTime - simStep;
+    }
+
     double avgFPS = 0.0;
     double avgUpdate = 0.0;
     double avgCompute = 0.0;
     double avgRender = 0.0;
 
+    histogramReset(&updateHist);
+    histogramReset(&computeHist);
+    histogramReset(&renderHist);
+    histogramReset(&frameHist);
+
     while (!WindowShouldClose()) {
 
         double frameStart = GetTime();
 
         // UPDATE
         double t0 = GetTime();
+        TRACE_BEGIN("update");
 
-        #ifdef UPDATE_ALL_BOIDS
-            updateAllBoids(flock, BOIDS);
-        #else
-            for (int i = 0; i < BOIDS; i++) {
-                updateBoid(flock[i], flock, BOIDS);
+        accumulator += frameStart - lastFrame;
+        lastFrame = frameStart;
+        if (accumulator > MAX_CATCH_UP * simStep)
+            accumulator = MAX_CATCH_UP * simStep;
+
+        while (accumulator >= simStep) {
+            int slice = steps % slices;
+
+            for (int i = slice; i < BOIDS; i += slices) {
+                previousOrigin[i] = flock[i]->origin;
+                previousRotation[i] = flock[i]->rotation;
+                previousTime[i] = flock[i]->lastUpdate;
             }
-        #endif
 
+            simTime += simStep;
+            accumulator -= simStep;
+            steps++;
+            boidSteps += (BOIDS - slice + slices - 1) / slices;
+
+            stepBoidsWith(flock, BOIDS, simTime, slice, slices, stepper, WIDTH, HEIGHT);
+        }
+
+        TRACE_END("update");
         double t1 = GetTime();
         totalUpdate += (t1 - t0);
+        histogramRecord(&updateHist, t1 - t0, frameCount);
 
         // COMPUTE
         double t2 = GetTime();
+        TRACE_BEGIN("vertex compute");
+
+        // frames show the flock one step behind, between the last two steps
+        double drawTime = simTime - simStep + accumulator;
 
         #pragma omp parallel for schedule(static)
             for (int i = 0; i < BOIDS; i++) {
                 Boid* b = flock[i];
-                triangles[i].v0 = (Vector2){b->positions[0].x + b->origin.x,
-                                             b->positions[0].y + b->origin.y};
-                triangles[i].v1 = (Vector2){b->positions[1].x + b->origin.x,
-                                             b->positions[1].y + b->origin.y};
-                triangles[i].v2 = (Vector2){b->positions[2].x + b->origin.x,
-                                             b->positions[2].y + b->origin.y};
+                Vector2 origin;
+                float back = 0.0f;
+
+                if (b->lastUpdate > drawTime) {
+                    // stepped since drawTime, blend from the state before that step
+                    float alpha = (float)((drawTime - previousTime[i]) / (b->lastUpdate - previousTime[i]));
+
+                    // a boid that wrapped jumps across the screen, not back over it
+                    float dx = wrapDelta(b->origin.x - previousOrigin[i].x, WIDTH);
+                    float dy = wrapDelta(b->origin.y - previousOrigin[i].y, HEIGHT);
+                    origin = (Vector2){previousOrigin[i].x + dx * alpha, previousOrigin[i].y + dy * alpha};
+
+                    // turn the current vertices back by the part of the step not yet shown
+                    back = -(1.0f - alpha) * wrapDelta(b->rotation - previousRotation[i], 2*M_PI);
+                } else {
+                    // waiting for its slice, carry on along its heading
+                    float ahead = (float)(drawTime - b->lastUpdate);
+                    float x = b->origin.x + sinf(b->rotation) * b->velocity.x * ahead;
+                    float y = b->origin.y - cosf(b->rotation) * b->velocity.y * ahead;
+                    origin = (Vector2){x - WIDTH * floorf(x / WIDTH), y - HEIGHT * floorf(y / HEIGHT)};
+                }
+
+                float s = sinf(back), c = cosf(back);
+
+                Vector2 v[3];
+                for (int k = 0; k < 3; k++) {
+                    BoidVec2 p = b->positions[k];
+                    v[k] = (Vector2){c * p.x - s * p.y + origin.x, s * p.x + c * p.y + origin.y};
+                }
+
+                triangles[i] = (Triangle){v[0], v[1], v[2]};
             }
 
+        TRACE_END("vertex compute");
         double t3 = GetTime();
         totalCompute += (t3 - t2);
+        histogramRecord(&computeHist, t3 - t2, frameCount);
 
         // RENDER
         double t4 = GetTime();
+        TRACE_BEGIN("draw submit");
 
         BeginDrawing();
         ClearBackground(RAYWHITE);
@@ -103,15 +214,19 @@ int main(void) {
         DrawText(TextFormat("Compute: %.3f ms",avgCompute),10, 60, 20, RED);
         DrawText(TextFormat("Render: %.3f ms", avgRender), 10, 85, 20, RED);
         DrawText(TextFormat("Boids: %d", BOIDS), 10, 110, 20, RED);
+        DrawText(TextFormat("Sim: %d Hz, 1/%d per step, %.1f Hz per boid", simRate, slices, avgBoidRate), 10, 135, 20, RED);
 
         #ifdef _OPENMP
-            DrawText(TextFormat("Threads: %d", omp_get_max_threads()), 10, 135, 20, RED);
+            DrawText(TextFormat("Threads: %d", omp_get_max_threads()), 10, 160, 20, RED);
         #endif
 
         EndDrawing();
 
+        TRACE_END("draw submit");
         double t5 = GetTime();
         totalRender += (t5 - t4);
+        histogramRecord(&renderHist, t5 - t4, frameCount);
+        histogramRecord(&frameHist, t5 - frameStart, frameCount);
 
         frameCount++;
 
@@ -123,6 +238,7 @@ int main(void) {
             avgUpdate = (totalUpdate  / frameCount) * 1000.0;
             avgCompute = (totalCompute / frameCount) * 1000.0;
             avgRender = (totalRender  / frameCount) * 1000.0;
+            avgBoidRate = (double)boidSteps / BOIDS / elapsed;
             lastUpdate = now;
         }
 
@@ -140,21 +256,25 @@ int main(void) {
             printf("Time: %.2f s\n", total);
             printf("FPS: %.2f\n", frameCount / total);
             printf("Avg frame: %.3f ms\n", (total / frameCount) * 1000.0);
+            printf("Sim: %d Hz, %d steps, 1/%d of the flock each, %s stepper\n", simRate, steps, slices,
+                   stepper == BOID_STEPPER_SERIAL ? "serial" : "parallel");
+            printf("Per boid: %.2f updates/s\n", (double)boidSteps / BOIDS / total);
             printf("Update: %.3f ms\n", avgUpdate);
             printf("Compute: %.3f ms\n", avgCompute);
             printf("Render: %.3f ms\n", avgRender);
 
-            FILE* fp = fopen("speedup_data.txt", "a");
-            if (fp) {
-                #ifdef _OPENMP
-                    fprintf(fp, "%d %.6f %.6f %.6f\n",
-                            omp_get_max_threads(), avgUpdate, avgCompute, avgRender);
-                #else
-                    fprintf(fp, "1 %.6f %.6f %.6f\n",
-                            avgUpdate, avgCompute, avgRender);
-                #endif
-                fclose(fp);
-            }
+            // tail latency per phase
+            printf("\n");
+            histogramPrintHeader(stdout);
+            histogramPrint(&updateHist, "Update", stdout);
+            histogramPrint(&computeHist, "Compute", stdout);
+            histogramPrint(&renderHist, "Render", stdout);
+            histogramPrint(&frameHist, "Frame", stdout);
+            printf("\n");
+            histogramPrintWorst(&updateHist, "Update", stdout);
+            histogramPrintWorst(&computeHist, "Compute", stdout);
+            histogramPrintWorst(&renderHist, "Render", stdout);
+            histogramPrintWorst(&frameHist, "Frame", stdout);
         }
     }
 
@@ -165,5 +285,6 @@ int main(void) {
     }
 
     CloseWindow();
+    TRACE_SHUTDOWN();
     return 0;
 }
\ No newline at end of file
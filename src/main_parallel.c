@@ -1,47 +1,295 @@
 #include <raylib.h>
 #include <rlgl.h>
 #include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <omp.h>
 
-#include "boids.h"
+#include "flock.h"
+#include "budget.h"
+#include "fixedflock.h"
+#include "grid.h"
+#include "numa.h"
+#include "snapshot.h"
+#include "trajectory.h"
+#include "framering.h"
+#include "capture.h"
+#include "render.h"
 #include "config.h"
+#include "trace.h"
 
 #define TITLE "Boids Example"
 
+static volatile sig_atomic_t running = 1;
+static uint64_t frame = 0;
+
+static void stop(int sig) {
+	(void)sig;
+	running = 0;
+}
+
+// predators over the flock in red, as triangles at any zoom
+static void drawPredators(const Flock* flock, Camera2D camera) {
+	float t[6];
+
+	if (flock->speciesCount < 2)
+		return;
+
+	BeginMode2D(camera);
+	for (int i = flock->speciesStart[1]; i < flock->count; i++) {
+		flockTriangle(flock, i, t);
+		DrawTriangle((Vector2){t[0], t[1]}, (Vector2){t[2], t[3]}, (Vector2){t[4], t[5]}, RED);
+	}
+	EndMode2D();
+}
+
+// captured videos advance exactly one frame of simulated time per frame
+static double frameClock(void) {
+	return (double)frame / FPS;
+}
+
 int main(int argc, char* argv[]) {
-	InitWindow(WIDTH, HEIGHT, TITLE);
-	rlDisableBackfaceCulling();
-	SetTargetFPS(FPS);
+	int BOIDS = NUM_BOIDS;
+	const char* loadPath = NULL;
+	const char* savePath = "flock.snap";
+	const char* recordPath = NULL;
+	const char* publishName = NULL;
+	const char* captureOutput = NULL;
+	uint64_t maxFrames = 0;
+	RenderLod lod = LOD_AUTO;
+	float worldScale = 1;
+	int headless = 0;
+	int numa = 0;
+	int adaptive = 0;
+	int fixedPoint = 0;
+	int symmetric = 0;
+	int tileCells = 0;
+	int predators = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--load") && i + 1 < argc)
+			loadPath = argv[++i];
+		else if (!strcmp(argv[i], "--save") && i + 1 < argc)
+			savePath = argv[++i];
+		else if (!strcmp(argv[i], "--record") && i + 1 < argc)
+			recordPath = argv[++i];
+		else if (!strcmp(argv[i], "--publish"))
+			publishName = i + 1 < argc && argv[i + 1][0] == '/' ? argv[++i] : FRAMERING_DEFAULT_NAME;
+		else if (!strcmp(argv[i], "--headless"))
+			headless = 1;
+		else if (!strcmp(argv[i], "--numa"))
+			numa = 1;
+		else if (!strcmp(argv[i], "--adaptive"))
+			adaptive = 1;
+		else if (!strcmp(argv[i], "--fixed"))
+			fixedPoint = 1;
+		else if (!strcmp(argv[i], "--symmetric"))
+			symmetric = 1;
+		else if (!strcmp(argv[i], "--tile") && i + 1 < argc)
+			tileCells = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--predators") && i + 1 < argc)
+			predators = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "--capture") && i + 1 < argc)
+			captureOutput = argv[++i];
+		else if (!strcmp(argv[i], "--world") && i + 1 < argc)
+			worldScale = atof(argv[++i]);
+		else if (!strcmp(argv[i], "--frames") && i + 1 < argc)
+			maxFrames = strtoull(argv[++i], NULL, 10);
+		else
+			BOIDS = atoi(argv[i]);
+	}
+
+	// capture renders offscreen and needs a context, not a visible window
+	if (captureOutput)
+		headless = 0;
+
+	// headless runs uncapped on the wall clock until interrupted
+	double (*simClock)(void) = captureOutput ? frameClock : headless ? omp_get_wtime : GetTime;
+
+	// frames to stdout, text to stderr from here on
+	if (captureOutput && !strcmp(captureOutput, "-") && captureClaimStdout())
+		return 1;
+
+	// pin the team before anything is first touched
+	if (numa) {
+		int nodes = numaBindThreads();
+		if (nodes > 0)
+			printf("numa: %d threads bound over %d node(s)\n", omp_get_max_threads(), nodes);
+	}
+
+	TRACE_INIT();
+	if (!headless) {
+		if (captureOutput)
+			SetConfigFlags(FLAG_WINDOW_HIDDEN);
+		InitWindow(WIDTH, HEIGHT, TITLE);
+		rlDisableBackfaceCulling();
+		SetTargetFPS(captureOutput ? 0 : FPS);
+	}
     SetRandomSeed(42690);
     srand(42690);
-	
-	int BOIDS = NUM_BOIDS;
-	if (argc > 1) {
-        BOIDS = atoi(argv[1]);
-    }
 
-	Boid* flock[BOIDS];
+	Flock flock;
+
+	if (loadPath) {
+		if (snapshotLoad(&flock, loadPath)) {
+			if (!headless)
+				CloseWindow();
+			return 1;
+		}
+	} else {
+		if (worldScale <= 0)
+			worldScale = 1;
+		if (flockCreate(&flock, BOIDS, WIDTH * worldScale, HEIGHT * worldScale)) {
+			if (!headless)
+				CloseWindow();
+			return 1;
+		}
 
-	for (int i = 0; i < BOIDS; i++)
-		flock[i] = newBoid((Vector2){GetRandomValue(0, WIDTH), GetRandomValue(0, HEIGHT)}, (Vector2){20, 20}, GetRandomValue(0, 6), 1);
+		for (int i = 0; i < BOIDS; i++) {
+			float x = GetRandomValue(0, (int)flock.width);
+			float y = GetRandomValue(0, (int)flock.height);
+			flockSetBoid(&flock, i, x, y, GetRandomValue(0, 6), 20, 20, 1);
+		}
+	}
 
-	while (!WindowShouldClose()){
-		updateAllBoids(flock, BOIDS);
+	// the last boids hunt the rest, which flee from them
+	if (predators > 0) {
+		Species species[2] = {SPECIES_DEFAULT, SPECIES_PREDATOR};
+		int counts[2] = {flock.count - predators, predators};
+		species[0].interaction[1] = SPECIES_AVOID;
+		if (flockSetSpecies(&flock, species, counts, 2))
+			fprintf(stderr, "species: cannot make %d of %d boids predators\n", predators, flock.count);
+	}
 
-		BeginDrawing();
-		ClearBackground(RAYWHITE);
+	// spatial order and owner first touch, before recording or publishing ids
+	if (numa && flockPlace(&flock, 1))
+		fprintf(stderr, "numa: placement failed, continuing unplaced\n");
+
+	flock.symmetric = symmetric;
+	flock.tileCells = tileCells;
+
+	// fixed point steps 1/FPS each frame whatever the clock says, flock is only drawn
+	FixedFlock fixed = {0};
+	if (fixedPoint && fixedCreate(&fixed, &flock, FPS))
+		running = 0;
+
+	// snapshots keep the time they were taken at, resume from now
+	flock.lastUpdate = simClock();
+
+	Recorder* recorder = recordPath ? recorderOpen(recordPath, &flock, FPS) : NULL;
+	FrameRing* ring = publishName ? frameRingCreate(publishName, flock.count, flock.width, flock.height) : NULL;
+	Capture* capture = captureOutput ? captureOpen(captureOutput, WIDTH, HEIGHT) : NULL;
+	if (captureOutput && !capture)
+		running = 0;
+
+	signal(SIGINT, stop);
+	signal(SIGTERM, stop);
+
+	// the world can be larger than the screen, start with all of it in view
+	Camera2D camera = headless ? (Camera2D){0} : fitCamera(flock.width, flock.height);
+
+	// windowed steps get half the frame, drawing needs the rest
+	Budget budget;
+	budgetInit(&budget, (headless ? 1.0 : 0.5) / FPS);
+	double stepTime = 0;
 
-		for (int i = 0; i < BOIDS; i++)
-			drawBoid(flock[i]);
+	double reportTime = simClock();
+	uint64_t reportFrame = 0;
 
+	while (running && (headless || !WindowShouldClose()) && (!maxFrames || frame < maxFrames)) {
+		// S writes a snapshot of the current flock
+		if (!headless && IsKeyPressed(KEY_S))
+			snapshotSave(&flock, savePath);
+
+		// L cycles auto, triangles, points, density
+		if (!headless && IsKeyPressed(KEY_L)) {
+			lod = (lod + 1) % (LOD_DENSITY + 1);
+			setRenderLod(lod);
+		}
+
+		// wheel zoom, right drag pan, R shows the whole world again
+		if (!headless && !capture) {
+			updateCamera(&camera);
+			if (IsKeyPressed(KEY_R))
+				camera = fitCamera(flock.width, flock.height);
+		}
+
+		TRACE_BEGIN("update");
+		if (fixedPoint) {
+			fixedStep(&fixed);
+			fixedToFlock(&fixed, &flock);
+		} else if (adaptive) {
+			if (!headless) {
+				Vector2 a = GetScreenToWorld2D((Vector2){0, 0}, camera);
+				Vector2 b = GetScreenToWorld2D((Vector2){WIDTH, HEIGHT}, camera);
+				budgetFocus(&budget, a.x, a.y, b.x, b.y);
+			}
+			stepTime = budgetStep(&budget, &flock, simClock());
+		} else {
+			updateFlock(&flock, simClock());
+		}
+		TRACE_END("update");
+
+		if (recorder)
+			recorderPush(recorder, &flock);
+
+		if (ring)
+			frameRingPublish(ring, &flock, frame);
+		frame++;
+
+		if (headless) {
+			double now = simClock();
+			if (now - reportTime >= 1.0) {
+				printf("%.1f steps/s, %d boids, %s grid %.1f MB\n", (frame - reportFrame) / (now - reportTime), flock.count,
+					   flock.grid && flock.grid->sparse ? "sparse" : "dense", flock.grid ? gridBytes(flock.grid) / 1e6 : 0.0);
+				if (fixedPoint)
+					printf("fixed point step %llu, checksum %016llx\n", (unsigned long long)fixed.steps, (unsigned long long)fixedChecksum(&fixed));
+				if (adaptive)
+					printf("quality %d (%s), step %.2f ms of %.2f\n", budget.level, budgetLevelName(budget.level), stepTime * 1e3, budget.target * 1e3);
+				fflush(stdout);
+				reportTime = now;
+				reportFrame = frame;
+			}
+			continue;
+		}
+
+		TRACE_BEGIN("draw submit");
+		BeginDrawing();
+		if (capture) {
+			captureBegin(capture);
+			ClearBackground(RAYWHITE);
+			drawFlock(&flock, camera, BLUE, NULL);
+			drawPredators(&flock, camera);
+			captureEnd(capture);
+		} else {
+			int visible;
+			ClearBackground(RAYWHITE);
+			RenderLod used = drawFlock(&flock, camera, BLUE, &visible);
+			drawPredators(&flock, camera);
+			DrawText(TextFormat("Drawn: %d / %d (%s)", visible, flock.count, lodName(used)), 10, 10, 20, RED);
+			if (adaptive)
+				DrawText(TextFormat("Quality: %d (%s), step %.1f ms", budget.level, budgetLevelName(budget.level), stepTime * 1e3), 10, 35, 20, RED);
+		}
 		EndDrawing();
+		TRACE_END("draw submit");
 	}
 
-	for (int i = 0; i < BOIDS; i++) {
-		free(flock[i]->positions);
-		free(flock[i]);
+	captureClose(capture);
+	frameRingClose(ring);
+	recorderClose(recorder);
+	budgetFree(&budget);
+	if (fixedPoint) {
+		printf("fixed point: %llu steps, checksum %016llx\n", (unsigned long long)fixed.steps, (unsigned long long)fixedChecksum(&fixed));
+		fixedDestroy(&fixed);
 	}
+	flockDestroy(&flock);
 
-	CloseWindow();
+	if (!headless) {
+		renderClose();
+		CloseWindow();
+	}
+	TRACE_SHUTDOWN();
 
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,178 @@
+#include <raylib.h>
+#include <rlgl.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "flock.h"
+#include "trajectory.h"
+#include "render.h"
+#include "histogram.h"
+#include "config.h"
+
+#define TITLE "Boids Replay"
+#define TIMELINE_HEIGHT 16
+
+static const float speeds[] = {0.25f, 0.5f, 1, 2, 4, 8, 16, 32};
+#define SPEED_COUNT (int)(sizeof(speeds) / sizeof(speeds[0]))
+
+static LatencyHistogram decodeHist, renderHist;
+
+static void usage(const char* name) {
+	printf("usage: %s FILE.traj [--bench]\n", name);
+	printf("  SPACE pause, LEFT/RIGHT step, UP/DOWN speed, PAGE UP/DOWN jump 10 s\n");
+	printf("  HOME/END first/last frame, click or drag the timeline to scrub\n");
+	printf("  mouse wheel zooms, right drag pans, R shows the whole world\n");
+	printf("  --bench renders every frame once as fast as possible and prints timings\n");
+}
+
+int main(int argc, char* argv[]) {
+	const char* path = NULL;
+	int bench = 0;
+
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--bench"))
+			bench = 1;
+		else
+			path = argv[i];
+	}
+
+	if (!path) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	TrajectoryReader* reader = trajectoryOpen(path);
+	if (!reader)
+		return 1;
+
+	int frames = trajectoryFrames(reader);
+	const TrajectoryHeader* header = trajectoryHeader(reader);
+
+	if (!frames) {
+		fprintf(stderr, "%s has no frames\n", path);
+		trajectoryClose(reader);
+		return 1;
+	}
+
+	Flock flock;
+	if (flockCreate(&flock, trajectoryCount(reader), header->width, header->height)) {
+		fprintf(stderr, "replay: no memory for %d boids\n", trajectoryCount(reader));
+		trajectoryClose(reader);
+		return 1;
+	}
+
+	printf("%s: %d boids, %d frames, keyframe every %u\n", path, flock.count, frames, header->keyframeInterval);
+
+	InitWindow(WIDTH, HEIGHT, TITLE);
+	rlDisableBackfaceCulling();
+	SetTargetFPS(bench ? 0 : FPS);
+
+	histogramReset(&decodeHist);
+	histogramReset(&renderHist);
+
+	double playhead = 0;
+	int speed = 2; // index into speeds, 1x
+	int paused = 0;
+	int shown = -1;
+	int failed = -1; // last frame that did not decode, not retried until another is shown
+	int next = 0; // bench frame, moves on whether or not it decodes
+	int skipped = 0;
+	Camera2D camera = fitCamera(flock.width, flock.height);
+
+	while (!WindowShouldClose()) {
+		if (bench) {
+			if (next >= frames)
+				break;
+			playhead = next++;
+		} else {
+			if (IsKeyPressed(KEY_SPACE))
+				paused = !paused;
+			if (IsKeyPressed(KEY_UP) && speed < SPEED_COUNT - 1)
+				speed++;
+			if (IsKeyPressed(KEY_DOWN) && speed > 0)
+				speed--;
+			if (IsKeyPressed(KEY_RIGHT) || IsKeyPressedRepeat(KEY_RIGHT))
+				playhead = (int)playhead + 1;
+			if (IsKeyPressed(KEY_LEFT) || IsKeyPressedRepeat(KEY_LEFT))
+				playhead = (int)playhead - 1;
+			if (IsKeyPressed(KEY_PAGE_UP))
+				playhead += 10 * FPS;
+			if (IsKeyPressed(KEY_PAGE_DOWN))
+				playhead -= 10 * FPS;
+			if (IsKeyPressed(KEY_HOME))
+				playhead = 0;
+			if (IsKeyPressed(KEY_END))
+				playhead = frames - 1;
+			if (IsKeyPressed(KEY_R))
+				camera = fitCamera(flock.width, flock.height);
+			updateCamera(&camera);
+
+			// scrub along the timeline at the bottom of the window
+			Vector2 mouse = GetMousePosition();
+			if (IsMouseButtonDown(MOUSE_BUTTON_LEFT) && mouse.y >= HEIGHT - TIMELINE_HEIGHT * 2)
+				playhead = mouse.x / WIDTH * (frames - 1);
+
+			if (!paused)
+				playhead += speeds[speed] * GetFrameTime() * FPS;
+
+			if (playhead < 0)
+				playhead = 0;
+			if (playhead > frames - 1) {
+				playhead = frames - 1;
+				paused = 1;
+			}
+		}
+
+		// far jumps seek through the keyframe index, short ones decode forward
+		int target = (int)playhead;
+		if (target != shown && target != failed) {
+			double t0 = GetTime();
+			if (trajectoryRead(reader, target, &flock) == 0) {
+				shown = target;
+				failed = -1;
+				histogramRecord(&decodeHist, GetTime() - t0, target);
+			} else {
+				fprintf(stderr, "%s: cannot decode frame %d\n", path, target);
+				failed = target;
+				skipped++;
+			}
+		}
+
+		double t1 = GetTime();
+		BeginDrawing();
+		ClearBackground(RAYWHITE);
+
+		RenderLod lod = drawFlock(&flock, camera, BLUE, NULL);
+
+		if (!bench) {
+			DrawRectangle(0, HEIGHT - TIMELINE_HEIGHT, WIDTH, TIMELINE_HEIGHT, LIGHTGRAY);
+			DrawRectangle(0, HEIGHT - TIMELINE_HEIGHT, (int)((float)shown / (frames > 1 ? frames - 1 : 1) * WIDTH), TIMELINE_HEIGHT, DARKGRAY);
+			DrawText(TextFormat("Frame: %d / %d", shown, frames - 1), 10, 10, 20, RED);
+			DrawText(TextFormat("Time: %.2f s", trajectoryTime(reader)), 10, 35, 20, RED);
+			DrawText(paused ? "Paused" : TextFormat("Speed: %gx", speeds[speed]), 10, 60, 20, RED);
+			DrawText(TextFormat("Boids: %d (%s)", flock.count, lodName(lod)), 10, 85, 20, RED);
+		}
+
+		EndDrawing();
+		histogramRecord(&renderHist, GetTime() - t1, shown);
+	}
+
+	if (bench) {
+		histogramPrintHeader(stdout);
+		histogramPrint(&decodeHist, "Decode", stdout);
+		histogramPrint(&renderHist, "Render", stdout);
+		printf("\n");
+		histogramPrintWorst(&decodeHist, "Decode", stdout);
+		histogramPrintWorst(&renderHist, "Render", stdout);
+		if (skipped)
+			printf("%d frames skipped, could not decode\n", skipped);
+	}
+
+	flockDestroy(&flock);
+	trajectoryClose(reader);
+	renderClose();
+	CloseWindow();
+
+	return 0;
+}
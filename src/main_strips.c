@@ -0,0 +1,151 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <omp.h>
+
+#include "flock.h"
+#include "strips.h"
+#include "config.h"
+
+// Headless run of the strip decomposition (strips.h) with a fixed 1/FPS
+// clock. --verify steps the same flock in this process as well, with
+// synchronous updates, and checks the two agree bit for bit.
+
+static unsigned int seed = 42690;
+
+static float randomFloat(float max) {
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) * (1.0f / 16777216.0f) * max;
+}
+
+static double wallTime(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char* name) {
+    printf("usage: %s [--strips N] [--boids N] [--steps N] [--world K] [--verify]\n", name);
+    printf("  --strips N  worker processes, one horizontal strip each (default 4)\n");
+    printf("  --boids N   flock size (default 20000)\n");
+    printf("  --steps N   steps to run (default 300)\n");
+    printf("  --world K   world K times the window in each direction (default 1)\n");
+    printf("  --verify    also step in this process and compare every boid\n");
+}
+
+int main(int argc, char* argv[]) {
+    int strips = 4, boids = 20000, steps = 300, verify = 0;
+    float world = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (!strcmp(arg, "--verify")) {
+            verify = 1;
+            continue;
+        }
+        if (!strcmp(arg, "--help") || !strcmp(arg, "-h")) {
+            usage(argv[0]);
+            return 0;
+        }
+        if (!value) {
+            fprintf(stderr, "missing value for %s\n", arg);
+            return 1;
+        }
+
+        if (!strcmp(arg, "--strips")) strips = atoi(value);
+        else if (!strcmp(arg, "--boids")) boids = atoi(value);
+        else if (!strcmp(arg, "--steps")) steps = atoi(value);
+        else if (!strcmp(arg, "--world")) world = atof(value);
+        else {
+            fprintf(stderr, "unknown option %s\n", arg);
+            usage(argv[0]);
+            return 1;
+        }
+        i++;
+    }
+
+    if (strips < 1 || boids < 1 || steps < 0 || world <= 0) {
+        fprintf(stderr, "invalid options\n");
+        return 1;
+    }
+
+    Flock flock, reference;
+    if (flockCreate(&flock, boids, WIDTH * world, HEIGHT * world))
+        return 1;
+
+    for (int i = 0; i < boids; i++)
+        flockSetBoid(&flock, i, randomFloat(flock.width), randomFloat(flock.height), (int)randomFloat(6), 20, 20, 1);
+
+    // workers fork before this process touches OpenMP
+    Strips* s = stripsStart(&flock, strips);
+    if (!s) {
+        flockDestroy(&flock);
+        return 1;
+    }
+
+    if (verify) {
+        if (flockCreate(&reference, boids, flock.width, flock.height)) {
+            stripsStop(s);
+            return 1;
+        }
+        memcpy(reference.storage, flock.storage, flock.storageSize);
+        reference.synchronous = 1;
+    }
+
+    int failed = 0;
+    double stripTime = 0, singleTime = 0;
+
+    for (int step = 1; step <= steps && !failed; step++) {
+        double now = (double)step / FPS;
+
+        double t0 = wallTime();
+        failed = stripsStep(s, now) != 0;
+        stripTime += wallTime() - t0;
+
+        if (verify) {
+            t0 = wallTime();
+            updateFlock(&reference, now);
+            singleTime += wallTime() - t0;
+        }
+    }
+
+    if (failed) {
+        fprintf(stderr, "strips: a worker failed\n");
+        stripsStop(s);
+        return 1;
+    }
+
+    int* counts = malloc(strips * sizeof(int));
+    stripsCounts(s, counts);
+
+    printf("%d boids, %d strips, %d steps: %.2f ms/step\n", boids, strips, steps, steps ? stripTime / steps * 1e3 : 0.0);
+    printf("boids per strip:");
+    for (int k = 0; k < strips; k++)
+        printf(" %d", counts[k]);
+    printf("\n");
+    free(counts);
+
+    failed = stripsGather(s, &flock) != 0;
+    stripsStop(s);
+
+    if (failed)
+        fprintf(stderr, "strips: gather lost boids\n");
+
+    if (verify && !failed) {
+        int mismatches = 0;
+        for (int i = 0; i < boids; i++)
+            if (flock.x[i] != reference.x[i] || flock.y[i] != reference.y[i] || flock.rotation[i] != reference.rotation[i])
+                mismatches++;
+
+        printf("single process (%d threads): %.2f ms/step\n", omp_get_max_threads(), steps ? singleTime / steps * 1e3 : 0.0);
+        printf("verify: %d of %d boids differ\n", mismatches, boids);
+        failed = mismatches != 0;
+        flockDestroy(&reference);
+    }
+
+    flockDestroy(&flock);
+    return failed;
+}
@@ -0,0 +1,89 @@
+#include <raylib.h>
+#include <rlgl.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "flock.h"
+#include "framering.h"
+#include "render.h"
+#include "config.h"
+
+#define TITLE "Boids Viewer"
+
+int main(int argc, char* argv[]) {
+	const char* name = argc > 1 ? argv[1] : FRAMERING_DEFAULT_NAME;
+
+	InitWindow(WIDTH, HEIGHT, TITLE);
+	rlDisableBackfaceCulling();
+	SetTargetFPS(FPS);
+
+	FrameRing* ring = NULL;
+	Flock view = {0};
+	uint64_t frame = 0, lastFrame = 0;
+	long shown = 0, skipped = 0, torn = 0;
+	RenderLod lod = LOD_AUTO;
+	Camera2D camera = fitCamera(WIDTH, HEIGHT);
+	float worldWidth = 0, worldHeight = 0;
+
+	while (!WindowShouldClose()) {
+		// wait for a simulation to publish, reattach if it restarts
+		if (ring && !frameRingWriterAlive(ring)) {
+			frameRingClose(ring);
+			ring = NULL;
+			view = (Flock){0};
+		}
+		if (!ring)
+			ring = frameRingAttach(name);
+
+		int fresh = ring && frameRingAcquire(ring, &view, &frame) == 0;
+		int held = fresh || (ring && view.count && frameRingRetain(ring) == 0);
+
+		// refit when attaching to a world of a different size
+		if (fresh && (view.width != worldWidth || view.height != worldHeight)) {
+			worldWidth = view.width;
+			worldHeight = view.height;
+			camera = fitCamera(worldWidth, worldHeight);
+		}
+		updateCamera(&camera);
+		if (IsKeyPressed(KEY_R) && worldWidth > 0)
+			camera = fitCamera(worldWidth, worldHeight);
+
+		BeginDrawing();
+		ClearBackground(RAYWHITE);
+
+		if (fresh) {
+			if (shown && frame > lastFrame + 1)
+				skipped += frame - lastFrame - 1;
+			lastFrame = frame;
+			shown++;
+		}
+
+		// with no newer frame the last one is drawn again from its slot,
+		// unless the writer has already started refilling it
+		if (held)
+			lod = drawFlock(&view, camera, BLUE, NULL);
+
+		// the writer reused the slot while we drew, the next frame replaces it
+		if (held && frameRingRelease(ring))
+			torn++;
+
+		if (!ring)
+			DrawText(TextFormat("Waiting for %s", name), 10, 10, 20, RED);
+		else {
+			DrawText(TextFormat("Sim frame: %llu", (unsigned long long)lastFrame), 10, 10, 20, RED);
+			DrawText(TextFormat("Boids: %d (%s)", view.count, lodName(lod)), 10, 35, 20, RED);
+			DrawText(TextFormat("Skipped: %ld  Torn: %ld", skipped, torn), 10, 60, 20, RED);
+			DrawText(TextFormat("FPS: %d", GetFPS()), 10, 85, 20, RED);
+		}
+
+		EndDrawing();
+	}
+
+	printf("Shown %ld frames, skipped %ld stale, %ld torn\n", shown, skipped, torn);
+
+	frameRingClose(ring);
+	renderClose();
+	CloseWindow();
+
+	return 0;
+}
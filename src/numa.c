@@ -0,0 +1,105 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <unistd.h>
+#include <omp.h>
+
+#include "numa.h"
+
+static NumaTopology topology;
+
+// "0-3,8,10-11" style lists
+static int parseList(const char* text, int* out, int max) {
+    int count = 0;
+
+    while (*text && count < max) {
+        char* end;
+        long first = strtol(text, &end, 10);
+        if (end == text)
+            break;
+
+        long last = first;
+        if (*end == '-')
+            last = strtol(end + 1, &end, 10);
+
+        for (long v = first; v <= last && count < max; v++)
+            out[count++] = (int)v;
+
+        text = *end == ',' ? end + 1 : end;
+    }
+
+    return count;
+}
+
+static int readList(const char* path, int* out, int max) {
+    char text[4096];
+    FILE* fp = fopen(path, "r");
+    if (!fp)
+        return -1;
+
+    int ok = fgets(text, sizeof(text), fp) != NULL;
+    fclose(fp);
+
+    return ok ? parseList(text, out, max) : -1;
+}
+
+int numaTopology(NumaTopology* topo) {
+    int nodes[NUMA_MAX_NODES];
+    int nodeCount = readList("/sys/devices/system/node/online", nodes, NUMA_MAX_NODES);
+
+    memset(topo, 0, sizeof(*topo));
+
+    for (int n = 0; n < nodeCount; n++) {
+        char path[128];
+        snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", nodes[n]);
+
+        int count = readList(path, topo->cpus[topo->nodes], NUMA_MAX_CPUS);
+        if (count > 0)
+            topo->cpuCount[topo->nodes++] = count;
+    }
+
+    // no sysfs topology, every online cpu on one node
+    if (!topo->nodes) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        topo->nodes = 1;
+        topo->cpuCount[0] = cpus > 0 && cpus < NUMA_MAX_CPUS ? (int)cpus : 1;
+        for (int c = 0; c < topo->cpuCount[0]; c++)
+            topo->cpus[0][c] = c;
+    }
+
+    return topo->nodes;
+}
+
+int numaBindThreads(void) {
+    if (numaTopology(&topology) < 1)
+        return -1;
+
+    int failed = 0;
+    int used = 0;
+
+    #pragma omp parallel reduction(+:failed) reduction(max:used)
+    {
+        int t = omp_get_thread_num();
+        int threads = omp_get_num_threads();
+
+        // split the team evenly over nodes, consecutive threads together
+        int node = (int)((long)t * topology.nodes / threads);
+        int first = (int)(((long)node * threads + topology.nodes - 1) / topology.nodes);
+        int cpu = topology.cpus[node][(t - first) % topology.cpuCount[node]];
+
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        failed += sched_setaffinity(0, sizeof(set), &set) != 0;
+        used = node + 1;
+    }
+
+    if (failed) {
+        fprintf(stderr, "numa: %d threads could not be bound\n", failed);
+        return -1;
+    }
+
+    return used;
+}
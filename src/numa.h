@@ -0,0 +1,21 @@
+#pragma once
+
+// NUMA placement without libnuma, from /sys/devices/system/node.
+//
+// numaBindThreads pins the OpenMP team node by node: consecutive thread
+// numbers share a node, one core each, so static loop chunks (consecutive
+// index ranges) stay on one socket. Pages belong to the node of the thread
+// that first writes them, so data should be first touched by the thread
+// that will own it, see flockPlace. Machines without the sysfs tree count
+// as a single node.
+#define NUMA_MAX_CPUS 1024
+#define NUMA_MAX_NODES 64
+
+typedef struct NumaTopology {
+    int nodes;
+    int cpuCount[NUMA_MAX_NODES];
+    int cpus[NUMA_MAX_NODES][NUMA_MAX_CPUS];
+} NumaTopology;
+
+int numaTopology(NumaTopology* topo);
+int numaBindThreads(void); // binds the current team size, returns nodes used or -1
@@ -0,0 +1,251 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <raylib.h>
+
+#include "render.h"
+#include "grid.h"
+
+#define TRIANGLE_SIZE 10.0f // the boid triangle is 10x10
+#define TRIANGLE_AREA 50.0f
+#define MIN_TRIANGLE_PIXELS 3.0f // smaller triangles are drawn as points
+#define POINT_COVERAGE 4.0f // pixels per boid below which points turn to density
+#define RAMP_SIZE 1024 // counts past this share the top shade
+#define MIN_ZOOM 0.01f
+#define MAX_ZOOM 64.0f
+
+static RenderLod forcedLod = LOD_AUTO;
+
+// splat target, sized to the screen and reallocated when it changes
+static unsigned int* counts;
+static Color* pixels;
+static Texture2D texture;
+static int splatWidth, splatHeight;
+
+// boids under the camera: whole grid rows of cells, each a contiguous run
+// of grid->indices, or every boid when there is no usable grid
+typedef struct Visible {
+    const Grid* grid;
+    int c0, r0, c1, r1;
+    int count;
+} Visible;
+
+RenderLod chooseLod(int visible, float area, float zoom) {
+    if (zoom * TRIANGLE_SIZE >= MIN_TRIANGLE_PIXELS && visible * TRIANGLE_AREA * zoom * zoom <= area)
+        return LOD_TRIANGLES;
+    if (visible * POINT_COVERAGE <= area)
+        return LOD_POINTS;
+    return LOD_DENSITY;
+}
+
+const char* lodName(RenderLod lod) {
+    static const char* names[] = {"auto", "triangles", "points", "density"};
+    return names[lod];
+}
+
+void setRenderLod(RenderLod lod) {
+    forcedLod = lod;
+}
+
+Camera2D fitCamera(float width, float height) {
+    float sw = GetScreenWidth(), sh = GetScreenHeight();
+    float zoom = fminf(sw / width, sh / height);
+
+    return (Camera2D){{sw / 2, sh / 2}, {width / 2, height / 2}, 0, zoom};
+}
+
+void updateCamera(Camera2D* camera) {
+    if (IsMouseButtonDown(MOUSE_BUTTON_RIGHT)) {
+        Vector2 delta = GetMouseDelta();
+        camera->target.x -= delta.x / camera->zoom;
+        camera->target.y -= delta.y / camera->zoom;
+    }
+
+    // keep the world point under the cursor fixed while zooming
+    float wheel = GetMouseWheelMove();
+    if (wheel != 0) {
+        Vector2 mouse = GetMousePosition();
+        camera->target = GetScreenToWorld2D(mouse, *camera);
+        camera->offset = mouse;
+        camera->zoom = fminf(MAX_ZOOM, fmaxf(MIN_ZOOM, camera->zoom * expf(0.2f * wheel)));
+    }
+}
+
+static Visible findVisible(const Flock* flock, Camera2D camera) {
+    Visible v = {0};
+    const Grid* grid = flock->grid;
+
+    if (!grid || grid->count != flock->count) {
+        v.count = flock->count;
+        return v;
+    }
+
+    // the grid is from the start of the step, one cell of margin covers the
+    // distance boids moved since, and triangles poking in from outside
+    float x0 = camera.target.x - camera.offset.x / camera.zoom;
+    float y0 = camera.target.y - camera.offset.y / camera.zoom;
+    float x1 = x0 + GetScreenWidth() / camera.zoom;
+    float y1 = y0 + GetScreenHeight() / camera.zoom;
+    float margin = grid->cellSize;
+
+    v.grid = grid;
+    gridCellRect(grid, x0 - margin, y0 - margin, x1 + margin, y1 + margin, &v.c0, &v.r0, &v.c1, &v.r1);
+
+    for (int r = v.r0; r <= v.r1; r++) {
+        int begin, end;
+        gridRowRange(grid, r, v.c0, v.c1, &begin, &end);
+        v.count += end - begin;
+    }
+
+    return v;
+}
+
+static void visibleRow(const Visible* v, int r, int* begin, int* end) {
+    if (!v->grid) {
+        *begin = 0;
+        *end = v->count;
+        return;
+    }
+
+    gridRowRange(v->grid, r, v->c0, v->c1, begin, end);
+}
+
+static int visibleBoid(const Visible* v, int a) {
+    return v->grid ? v->grid->indices[a] : a;
+}
+
+static int splatResize(int width, int height) {
+    if (width == splatWidth && height == splatHeight)
+        return 0;
+
+    renderClose();
+
+    counts = malloc((size_t)width * height * sizeof(unsigned int));
+    pixels = calloc((size_t)width * height, sizeof(Color));
+    if (!counts || !pixels) {
+        renderClose();
+        return -1;
+    }
+
+    Image image = {pixels, width, height, 1, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8};
+    texture = LoadTextureFromImage(image);
+    splatWidth = width;
+    splatHeight = height;
+
+    return 0;
+}
+
+static inline void splatBoid(const float* x, const float* y, int i, float zoom, float ox, float oy, int width, int height) {
+    int px = (int)floorf(x[i] * zoom + ox);
+    int py = (int)floorf(y[i] * zoom + oy);
+    if (px < 0 || px >= width || py < 0 || py >= height)
+        return;
+
+    #pragma omp atomic update
+    counts[py * width + px]++;
+}
+
+static void drawSplat(const Flock* flock, const Visible* v, Camera2D camera, Color color, RenderLod lod) {
+    int width = GetScreenWidth();
+    int height = GetScreenHeight();
+    if (width <= 0 || height <= 0 || splatResize(width, height))
+        return;
+
+    int n = width * height;
+    const float* x = flock->x;
+    const float* y = flock->y;
+    float ox = camera.offset.x - camera.target.x * camera.zoom;
+    float oy = camera.offset.y - camera.target.y * camera.zoom;
+    unsigned int top = 0;
+    unsigned char ramp[RAMP_SIZE];
+
+    memset(counts, 0, n * sizeof(unsigned int));
+
+    #pragma omp parallel
+    {
+        // culled rows vary a lot in size, without a grid there is one row
+        if (v->grid) {
+            #pragma omp for schedule(dynamic, 1)
+            for (int r = v->r0; r <= v->r1; r++) {
+                int begin, end;
+                visibleRow(v, r, &begin, &end);
+
+                for (int a = begin; a < end; a++)
+                    splatBoid(x, y, visibleBoid(v, a), camera.zoom, ox, oy, width, height);
+            }
+        } else {
+            #pragma omp for schedule(static)
+            for (int i = 0; i < v->count; i++)
+                splatBoid(x, y, i, camera.zoom, ox, oy, width, height);
+        }
+
+        if (lod == LOD_DENSITY) {
+            #pragma omp for schedule(static) reduction(max:top)
+            for (int p = 0; p < n; p++)
+                if (counts[p] > top)
+                    top = counts[p];
+        }
+
+        // log scale so sparse edges stay visible next to dense cores
+        #pragma omp single
+        {
+            if (top >= RAMP_SIZE)
+                top = RAMP_SIZE - 1;
+            float scale = top > 1 ? 1.0f / logf(1.0f + top) : 1.0f;
+
+            ramp[0] = 0;
+            for (unsigned int c = 1; c < RAMP_SIZE; c++)
+                ramp[c] = lod == LOD_DENSITY ? (unsigned char)(64 + 191 * fminf(1.0f, logf(1.0f + c) * scale)) : color.a;
+        }
+
+        #pragma omp for schedule(static)
+        for (int p = 0; p < n; p++) {
+            Color c = color;
+            c.a = ramp[counts[p] < RAMP_SIZE ? counts[p] : RAMP_SIZE - 1];
+            pixels[p] = c;
+        }
+    }
+
+    UpdateTexture(texture, pixels);
+    DrawTexture(texture, 0, 0, WHITE);
+}
+
+RenderLod drawFlock(const Flock* flock, Camera2D camera, Color color, int* visible) {
+    Visible v = findVisible(flock, camera);
+    RenderLod lod = forcedLod != LOD_AUTO ? forcedLod
+        : chooseLod(v.count, (float)GetScreenWidth() * GetScreenHeight(), camera.zoom);
+
+    if (visible)
+        *visible = v.count;
+
+    if (lod != LOD_TRIANGLES) {
+        drawSplat(flock, &v, camera, color, lod);
+        return lod;
+    }
+
+    float t[6];
+
+    BeginMode2D(camera);
+    for (int r = v.r0; r <= v.r1; r++) {
+        int begin, end;
+        visibleRow(&v, r, &begin, &end);
+
+        for (int a = begin; a < end; a++) {
+            flockTriangle(flock, visibleBoid(&v, a), t);
+            DrawTriangle((Vector2){t[0], t[1]}, (Vector2){t[2], t[3]}, (Vector2){t[4], t[5]}, color);
+        }
+    }
+    EndMode2D();
+
+    return lod;
+}
+
+void renderClose(void) {
+    if (splatWidth)
+        UnloadTexture(texture);
+    free(counts);
+    free(pixels);
+    counts = NULL;
+    pixels = NULL;
+    splatWidth = splatHeight = 0;
+}
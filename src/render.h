@@ -0,0 +1,31 @@
+#pragma once
+#include <raylib.h>
+#include "flock.h"
+
+// Level of detail follows on-screen density. Triangles while they are a few
+// pixels wide and would not overlap on average, one pixel per boid while
+// boids still cover a minority of the pixels, and past that a per-pixel
+// density image. Points and density are accumulated on the CPU and
+// uploaded as a single screen-sized texture, so their cost is one pass over
+// the visible boids plus one upload however many there are.
+//
+// Only boids in grid cells overlapping the camera view are touched, so
+// draw cost follows what is on screen rather than the whole flock. Flocks
+// without a grid (replays, shared memory views) fall back to a full pass.
+typedef enum RenderLod {
+    LOD_AUTO,
+    LOD_TRIANGLES,
+    LOD_POINTS,
+    LOD_DENSITY,
+} RenderLod;
+
+RenderLod chooseLod(int visible, float area, float zoom); // area in screen pixels
+const char* lodName(RenderLod lod);
+void setRenderLod(RenderLod lod); // LOD_AUTO picks per frame
+
+Camera2D fitCamera(float width, float height); // whole world centered on screen
+void updateCamera(Camera2D* camera); // wheel zooms at the cursor, right drag pans
+
+// call outside BeginMode2D, returns the level used and the boids considered
+RenderLod drawFlock(const Flock* flock, Camera2D camera, Color color, int* visible);
+void renderClose(void); // frees the splat texture, call before CloseWindow
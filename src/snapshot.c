@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "snapshot.h"
+
+#if __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "snapshots are little endian and mapped without conversion"
+#endif
+
+#define COLUMNS 6
+
+_Static_assert(sizeof(SnapshotHeader) == 64, "snapshot header must be 64 bytes");
+_Static_assert(sizeof(SnapshotColumn) == 32, "snapshot column entry must be 32 bytes");
+_Static_assert(sizeof(SnapshotSpecies) == 40, "snapshot species entry must be 40 bytes");
+
+static uint64_t alignUp(uint64_t value) {
+    return (value + FLOCK_ALIGNMENT - 1) & ~(uint64_t)(FLOCK_ALIGNMENT - 1);
+}
+
+static float** columnPointer(Flock* flock, uint32_t id) {
+    switch (id) {
+        case SNAPSHOT_COLUMN_X: return &flock->x;
+        case SNAPSHOT_COLUMN_Y: return &flock->y;
+        case SNAPSHOT_COLUMN_ROTATION: return &flock->rotation;
+        case SNAPSHOT_COLUMN_SPEED_X: return &flock->speedX;
+        case SNAPSHOT_COLUMN_SPEED_Y: return &flock->speedY;
+        case SNAPSHOT_COLUMN_ANGULAR_VELOCITY: return &flock->angularVelocity;
+        default: return NULL;
+    }
+}
+
+int snapshotSave(const Flock* flock, const char* path) {
+    static const char padding[FLOCK_ALIGNMENT];
+    const uint32_t ids[COLUMNS] = {
+        SNAPSHOT_COLUMN_X, SNAPSHOT_COLUMN_Y, SNAPSHOT_COLUMN_ROTATION,
+        SNAPSHOT_COLUMN_SPEED_X, SNAPSHOT_COLUMN_SPEED_Y, SNAPSHOT_COLUMN_ANGULAR_VELOCITY
+    };
+
+    int species = flock->speciesCount > 1 ? flock->speciesCount : 0;
+    int entries = COLUMNS + (species > 0);
+    SnapshotHeader header = {0};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.endianMark = SNAPSHOT_ENDIAN_MARK;
+    header.count = (uint64_t)flock->count;
+    header.columnCount = entries;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.lastUpdate = flock->lastUpdate;
+    header.width = flock->width;
+    header.height = flock->height;
+
+    uint64_t size = sizeof(float) * (uint64_t)flock->count;
+    uint64_t stride = flockColumnStride(flock->count);
+    uint64_t first = alignUp(sizeof(SnapshotHeader) + entries * sizeof(SnapshotColumn));
+    SnapshotColumn columns[COLUMNS + 1];
+    SnapshotSpecies runs[FLOCK_MAX_SPECIES];
+
+    for (int c = 0; c < COLUMNS; c++)
+        columns[c] = (SnapshotColumn){ids[c], sizeof(float), first + c * stride, size, 0};
+
+    for (int s = 0; s < species; s++) {
+        const Species* sp = &flock->species[s];
+        runs[s] = (SnapshotSpecies){(uint32_t)(flock->speciesStart[s + 1] - flock->speciesStart[s]), sp->speed, sp->angularVelocity,
+                                    sp->radius, sp->flee, sp->separation, sp->cohesion, {0}, 0};
+        memcpy(runs[s].interaction, sp->interaction, sizeof(runs[s].interaction));
+    }
+    if (species)
+        columns[COLUMNS] = (SnapshotColumn){SNAPSHOT_BLOCK_SPECIES, sizeof(SnapshotSpecies), first + COLUMNS * stride,
+                                            species * sizeof(SnapshotSpecies), 0};
+
+    // write next to the target and rename so readers never map a partial file
+    char tmpPath[4096];
+    snprintf(tmpPath, sizeof(tmpPath), "%s.tmp", path);
+
+    FILE* fp = fopen(tmpPath, "wb");
+    if (!fp) {
+        fprintf(stderr, "snapshot: cannot open %s\n", tmpPath);
+        return -1;
+    }
+
+    int ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    ok = ok && fwrite(columns, sizeof(SnapshotColumn), entries, fp) == (size_t)entries;
+    ok = ok && fwrite(padding, first - sizeof(header) - entries * sizeof(SnapshotColumn), 1, fp) <= 1;
+
+    for (int c = 0; c < COLUMNS && ok; c++) {
+        float** column = columnPointer((Flock*)flock, ids[c]);
+        ok = fwrite(*column, 1, size, fp) == size;
+        ok = ok && fwrite(padding, 1, stride - size, fp) == stride - size;
+    }
+    if (species && ok)
+        ok = fwrite(runs, sizeof(SnapshotSpecies), species, fp) == (size_t)species;
+
+    ok = fclose(fp) == 0 && ok;
+    if (!ok || rename(tmpPath, path) != 0) {
+        fprintf(stderr, "snapshot: failed to write %s\n", path);
+        remove(tmpPath);
+        return -1;
+    }
+
+    return 0;
+}
+
+static int fail(const char* path, const char* reason, void* base, size_t size) {
+    fprintf(stderr, "snapshot: %s: %s\n", path, reason);
+    if (base)
+        munmap(base, size);
+    return -1;
+}
+
+int snapshotLoad(Flock* flock, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return fail(path, "cannot open", NULL, 0);
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotHeader)) {
+        close(fd);
+        return fail(path, "too small", NULL, 0);
+    }
+
+    // private so the simulation can step the mapped columns in place
+    size_t fileSize = (size_t)st.st_size;
+    char* base = mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED)
+        return fail(path, "mmap failed", NULL, 0);
+
+    const SnapshotHeader* header = (const SnapshotHeader*)base;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0)
+        return fail(path, "not a snapshot", base, fileSize);
+    if (header->endianMark != SNAPSHOT_ENDIAN_MARK)
+        return fail(path, "wrong byte order", base, fileSize);
+    if (header->version < 1 || header->version > SNAPSHOT_VERSION)
+        return fail(path, "unsupported version", base, fileSize);
+    if (header->headerSize < sizeof(SnapshotHeader) || header->count > INT32_MAX
+        || header->headerSize + (uint64_t)header->columnCount * sizeof(SnapshotColumn) > fileSize)
+        return fail(path, "corrupt header", base, fileSize);
+
+    memset(flock, 0, sizeof(*flock));
+    flock->count = (int)header->count;
+    flock->width = header->width;
+    flock->height = header->height;
+    flock->lastUpdate = header->lastUpdate;
+
+    const SnapshotColumn* columns = (const SnapshotColumn*)(base + header->headerSize);
+    const SnapshotColumn* speciesBlock = NULL;
+    for (uint32_t c = 0; c < header->columnCount; c++) {
+        const SnapshotColumn* column = &columns[c];
+        float** target = columnPointer(flock, column->id);
+
+        if (column->id == SNAPSHOT_BLOCK_SPECIES) {
+            if (column->elementSize != sizeof(SnapshotSpecies) || column->size % sizeof(SnapshotSpecies)
+                || column->size / sizeof(SnapshotSpecies) - 1 >= FLOCK_MAX_SPECIES || column->offset % sizeof(uint32_t)
+                || column->offset + column->size > fileSize)
+                return fail(path, "corrupt species block", base, fileSize);
+            speciesBlock = column;
+            continue;
+        }
+
+        // unknown columns are from newer writers, skip them
+        if (!target)
+            continue;
+
+        if (column->elementSize != sizeof(float) || column->offset % FLOCK_ALIGNMENT
+            || column->size < header->count * sizeof(float) || column->offset + column->size > fileSize)
+            return fail(path, "corrupt column", base, fileSize);
+
+        *target = (float*)(base + column->offset);
+    }
+
+    if (!flock->x || !flock->y || !flock->rotation || !flock->speedX || !flock->speedY || !flock->angularVelocity)
+        return fail(path, "missing column", base, fileSize);
+
+    if (speciesBlock) {
+        const SnapshotSpecies* runs = (const SnapshotSpecies*)(base + speciesBlock->offset);
+        int count = (int)(speciesBlock->size / sizeof(SnapshotSpecies));
+        Species species[FLOCK_MAX_SPECIES];
+        int counts[FLOCK_MAX_SPECIES];
+
+        for (int s = 0; s < count; s++) {
+            species[s] = (Species){runs[s].speed, runs[s].angularVelocity, runs[s].radius, runs[s].flee, runs[s].separation, runs[s].cohesion, {0}};
+            memcpy(species[s].interaction, runs[s].interaction, sizeof(species[s].interaction));
+            counts[s] = runs[s].count > INT32_MAX ? -1 : (int)runs[s].count;
+        }
+
+        // the saved speeds stay, they may differ from boid to boid
+        if (flockGroupSpecies(flock, species, counts, count))
+            return fail(path, "species do not fit the flock", base, fileSize);
+    }
+
+    flock->storage = base;
+    flock->storageSize = fileSize;
+    flock->mapped = 1;
+
+    return 0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <stdint.h>
+#include "flock.h"
+
+// Binary flock snapshot, little endian, version 2.
+//
+//   offset 0    SnapshotHeader (64 bytes)
+//   offset 64   SnapshotColumn directory, columnCount entries
+//   ...         column blocks, each starting on a 64-byte boundary
+//
+// Column blocks are raw float32 arrays laid out exactly like Flock columns,
+// so snapshotLoad maps the file and points the flock straight at them.
+// Mixed flocks add a species block after the columns: one SnapshotSpecies
+// per species, in run order. Version 1 files, without it, still load as
+// one default species.
+#define SNAPSHOT_MAGIC "BOIDSNAP"
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_ENDIAN_MARK 0x01020304u
+
+enum {
+    SNAPSHOT_COLUMN_X = 1,
+    SNAPSHOT_COLUMN_Y,
+    SNAPSHOT_COLUMN_ROTATION,
+    SNAPSHOT_COLUMN_SPEED_X,
+    SNAPSHOT_COLUMN_SPEED_Y,
+    SNAPSHOT_COLUMN_ANGULAR_VELOCITY,
+    SNAPSHOT_BLOCK_SPECIES = 64,
+};
+
+typedef struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t endianMark;
+    uint64_t count;
+    uint32_t columnCount;
+    uint32_t headerSize;
+    double lastUpdate;
+    float width;
+    float height;
+    uint8_t reserved[16];
+} SnapshotHeader;
+
+typedef struct SnapshotSpecies {
+    uint32_t count; // boids in the run
+    float speed;
+    float angularVelocity;
+    float radius;
+    float flee;
+    float separation;
+    float cohesion;
+    uint8_t interaction[FLOCK_MAX_SPECIES];
+    uint32_t reserved;
+} SnapshotSpecies;
+
+typedef struct SnapshotColumn {
+    uint32_t id;
+    uint32_t elementSize;
+    uint64_t offset; // from the start of the file
+    uint64_t size; // bytes, without padding
+    uint64_t reserved;
+} SnapshotColumn;
+
+int snapshotSave(const Flock* flock, const char* path);
+int snapshotLoad(Flock* flock, const char* path); // columns alias a private mapping, release with flockDestroy
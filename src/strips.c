@@ -0,0 +1,558 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <omp.h>
+
+#include "strips.h"
+
+#define HALO 51.0f // neighbor radius plus slack for rounding at strip borders
+
+enum { CMD_STEP = 1, CMD_GATHER, CMD_STOP, REPLY_DONE, REPLY_BOIDS };
+
+typedef struct Message {
+    uint32_t type;
+    uint32_t count;
+    double now;
+} Message;
+
+typedef struct Buffer {
+    StripBoid* boids;
+    int count;
+    int capacity;
+} Buffer;
+
+// one direction pair of a neighbor exchange, see exchange()
+typedef struct Channel {
+    int fd;
+    const Buffer* out;
+    uint32_t outCount;
+    size_t sent;
+    Buffer* in;
+    uint32_t inCount;
+    size_t received;
+} Channel;
+
+typedef struct Worker {
+    int strip;
+    int strips;
+    float width;
+    float height;
+    int control;
+    int up; // socket to the strip above, the last strip for the first one
+    int down;
+
+    Buffer owned; // sorted by id
+    Buffer toUp, toDown, fromUp, fromDown;
+
+    Flock local; // owned and halo boids merged by id
+    uint32_t* ids;
+    unsigned char* active;
+    int capacity;
+    double lastUpdate;
+} Worker;
+
+struct Strips {
+    int count;
+    pid_t* pids;
+    int* fds;
+    int* counts;
+};
+
+static int writeAll(int fd, const void* data, size_t size) {
+    const char* p = data;
+
+    while (size) {
+        ssize_t n = send(fd, p, size, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+static int readAll(int fd, void* data, size_t size) {
+    char* p = data;
+
+    while (size) {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+        p += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+static int reserve(Buffer* b, int count) {
+    if (count <= b->capacity)
+        return 0;
+
+    int capacity = b->capacity ? b->capacity : 256;
+    while (capacity < count)
+        capacity *= 2;
+
+    StripBoid* boids = realloc(b->boids, capacity * sizeof(StripBoid));
+    if (!boids)
+        return -1;
+
+    b->boids = boids;
+    b->capacity = capacity;
+    return 0;
+}
+
+static int push(Buffer* b, StripBoid boid) {
+    if (reserve(b, b->count + 1))
+        return -1;
+    b->boids[b->count++] = boid;
+    return 0;
+}
+
+static int compareId(const void* a, const void* b) {
+    uint32_t x = ((const StripBoid*)a)->id, y = ((const StripBoid*)b)->id;
+    return (x > y) - (x < y);
+}
+
+static int stripOf(const Worker* w, float y) {
+    int s = (int)(y / w->height * w->strips);
+    return s < 0 ? 0 : s >= w->strips ? w->strips - 1 : s;
+}
+
+static int channelDone(const Channel* c) {
+    size_t outSize = sizeof(uint32_t) + c->outCount * sizeof(StripBoid);
+    size_t inSize = sizeof(uint32_t) + c->inCount * sizeof(StripBoid);
+    return c->sent == outSize && c->received >= sizeof(uint32_t) && c->received == inSize;
+}
+
+// advances the send and receive side of a channel as far as the socket allows
+static int channelPump(Channel* c, short revents) {
+    if ((revents & POLLOUT) && c->sent < sizeof(uint32_t) + c->outCount * sizeof(StripBoid)) {
+        const char* p = c->sent < sizeof(uint32_t) ? (const char*)&c->outCount + c->sent
+            : (const char*)c->out->boids + (c->sent - sizeof(uint32_t));
+        size_t left = c->sent < sizeof(uint32_t) ? sizeof(uint32_t) - c->sent
+            : c->outCount * sizeof(StripBoid) - (c->sent - sizeof(uint32_t));
+
+        ssize_t n = send(c->fd, p, left, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0 && errno != EAGAIN && errno != EINTR)
+            return -1;
+        if (n > 0)
+            c->sent += n;
+    }
+
+    if (revents & (POLLIN | POLLHUP)) {
+        char* p;
+        size_t left;
+
+        if (c->received < sizeof(uint32_t)) {
+            p = (char*)&c->inCount + c->received;
+            left = sizeof(uint32_t) - c->received;
+        } else {
+            p = (char*)c->in->boids + (c->received - sizeof(uint32_t));
+            left = c->inCount * sizeof(StripBoid) - (c->received - sizeof(uint32_t));
+        }
+
+        if (left) {
+            ssize_t n = recv(c->fd, p, left, MSG_DONTWAIT);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EINTR))
+                return -1;
+            if (n > 0)
+                c->received += n;
+
+            // header complete, make room for the payload
+            if (c->received == sizeof(uint32_t)) {
+                if (reserve(c->in, (int)c->inCount))
+                    return -1;
+                c->in->count = (int)c->inCount;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// sends toUp and toDown while receiving fromUp and fromDown, both at once so
+// neighbors filling each other's socket buffers cannot deadlock
+static int exchange(Worker* w) {
+    Channel channels[2] = {
+        {w->up, &w->toUp, (uint32_t)w->toUp.count, 0, &w->fromUp, 0, 0},
+        {w->down, &w->toDown, (uint32_t)w->toDown.count, 0, &w->fromDown, 0, 0},
+    };
+
+    w->fromUp.count = w->fromDown.count = 0;
+
+    while (!channelDone(&channels[0]) || !channelDone(&channels[1])) {
+        struct pollfd fds[2];
+
+        for (int c = 0; c < 2; c++) {
+            size_t outSize = sizeof(uint32_t) + channels[c].outCount * sizeof(StripBoid);
+            fds[c].fd = channels[c].fd;
+            fds[c].events = (channels[c].sent < outSize ? POLLOUT : 0) | (channelDone(&channels[c]) ? 0 : POLLIN);
+            fds[c].revents = 0;
+        }
+
+        if (poll(fds, 2, -1) < 0 && errno != EINTR)
+            return -1;
+
+        for (int c = 0; c < 2; c++)
+            if (fds[c].revents && channelPump(&channels[c], fds[c].revents))
+                return -1;
+    }
+
+    return 0;
+}
+
+static int reserveLocal(Worker* w, int count) {
+    if (count <= w->capacity)
+        return 0;
+
+    int capacity = w->capacity ? w->capacity : 1024;
+    while (capacity < count)
+        capacity *= 2;
+
+    flockDestroy(&w->local);
+    free(w->ids);
+    free(w->active);
+
+    w->ids = malloc(capacity * sizeof(uint32_t));
+    w->active = malloc(capacity);
+    if (flockCreate(&w->local, capacity, w->width, w->height) || !w->ids || !w->active)
+        return -1;
+
+    w->local.synchronous = 1;
+    w->capacity = capacity;
+    return 0;
+}
+
+static void placeLocal(Worker* w, int p, const StripBoid* b, unsigned char active) {
+    Flock* f = &w->local;
+
+    f->x[p] = b->x;
+    f->y[p] = b->y;
+    f->rotation[p] = b->rotation;
+    f->speedX[p] = b->speedX;
+    f->speedY[p] = b->speedY;
+    f->angularVelocity[p] = b->angularVelocity;
+    w->ids[p] = b->id;
+    w->active[p] = active;
+}
+
+static int workerStep(Worker* w, double now) {
+    float top = w->strip * w->height / w->strips;
+    float bottom = (w->strip + 1) * w->height / w->strips;
+
+    // halos, none across the vertical wrap since distances do not wrap
+    w->toUp.count = w->toDown.count = 0;
+    for (int i = 0; i < w->owned.count; i++) {
+        const StripBoid* b = &w->owned.boids[i];
+        if (w->strip > 0 && b->y < top + HALO && push(&w->toUp, *b))
+            return -1;
+        if (w->strip < w->strips - 1 && b->y >= bottom - HALO && push(&w->toDown, *b))
+            return -1;
+    }
+
+    if (w->strips > 1 && exchange(w))
+        return -1;
+
+    // owned and both halos are sorted by id, merge them
+    int n = w->owned.count + w->fromUp.count + w->fromDown.count;
+    if (reserveLocal(w, n))
+        return -1;
+
+    const Buffer* lists[3] = {&w->owned, &w->fromUp, &w->fromDown};
+    int cursor[3] = {0, 0, 0};
+
+    for (int p = 0; p < n; p++) {
+        int m = -1;
+        for (int l = 0; l < 3; l++) {
+            if (cursor[l] < lists[l]->count
+                && (m < 0 || lists[l]->boids[cursor[l]].id < lists[m]->boids[cursor[m]].id))
+                m = l;
+        }
+
+        placeLocal(w, p, &lists[m]->boids[cursor[m]++], m == 0);
+    }
+
+    w->local.count = n;
+    w->local.lastUpdate = w->lastUpdate;
+    updateFlockActive(&w->local, now, w->active);
+    w->lastUpdate = now;
+
+    // keep what is still ours, hand the rest to the strip it moved into
+    int above = (w->strip + w->strips - 1) % w->strips;
+    int below = (w->strip + 1) % w->strips;
+
+    w->owned.count = w->toUp.count = w->toDown.count = 0;
+    for (int p = 0; p < n; p++) {
+        if (!w->active[p])
+            continue;
+
+        const Flock* f = &w->local;
+        StripBoid b = {w->ids[p], f->x[p], f->y[p], f->rotation[p], f->speedX[p], f->speedY[p], f->angularVelocity[p]};
+        int s = stripOf(w, b.y);
+        Buffer* target = s == w->strip ? &w->owned : s == above ? &w->toUp : s == below ? &w->toDown : NULL;
+
+        if (!target) {
+            fprintf(stderr, "strips: boid %u jumped from strip %d to %d, strips are too thin\n", b.id, w->strip, s);
+            return -1;
+        }
+        if (push(target, b))
+            return -1;
+    }
+
+    if (w->strips > 1) {
+        if (exchange(w))
+            return -1;
+
+        for (int i = 0; i < w->fromUp.count; i++)
+            if (push(&w->owned, w->fromUp.boids[i]))
+                return -1;
+        for (int i = 0; i < w->fromDown.count; i++)
+            if (push(&w->owned, w->fromDown.boids[i]))
+                return -1;
+
+        if (w->fromUp.count || w->fromDown.count)
+            qsort(w->owned.boids, w->owned.count, sizeof(StripBoid), compareId);
+    }
+
+    return 0;
+}
+
+static void workerMain(Worker* w, const Flock* flock) {
+    // take our strip from the flock inherited through fork, ids stay sorted
+    for (int i = 0; i < flock->count; i++) {
+        if (stripOf(w, flock->y[i]) != w->strip)
+            continue;
+
+        StripBoid b = {(uint32_t)i, flock->x[i], flock->y[i], flock->rotation[i],
+                       flock->speedX[i], flock->speedY[i], flock->angularVelocity[i]};
+        if (push(&w->owned, b))
+            return;
+    }
+
+    if (w->strips > 1) {
+        fcntl(w->up, F_SETFL, fcntl(w->up, F_GETFL) | O_NONBLOCK);
+        fcntl(w->down, F_SETFL, fcntl(w->down, F_GETFL) | O_NONBLOCK);
+    }
+
+    for (;;) {
+        Message m;
+        if (readAll(w->control, &m, sizeof(m)))
+            return;
+
+        if (m.type == CMD_STOP)
+            return;
+
+        if (m.type == CMD_STEP) {
+            int ok = workerStep(w, m.now) == 0;
+            Message reply = {REPLY_DONE, ok ? (uint32_t)w->owned.count : UINT32_MAX, m.now};
+            if (writeAll(w->control, &reply, sizeof(reply)) || !ok)
+                return;
+        } else if (m.type == CMD_GATHER) {
+            Message reply = {REPLY_BOIDS, (uint32_t)w->owned.count, w->lastUpdate};
+            if (writeAll(w->control, &reply, sizeof(reply))
+                || writeAll(w->control, w->owned.boids, w->owned.count * sizeof(StripBoid)))
+                return;
+        }
+    }
+}
+
+Strips* stripsStart(const Flock* flock, int strips) {
+    if (strips < 1 || flock->height / strips < 2 * HALO) {
+        fprintf(stderr, "strips: %d strips leave less than two neighbor radii per strip\n", strips);
+        return NULL;
+    }
+    if (flock->speciesCount > 1) {
+        fprintf(stderr, "strips: workers step one species, the flock has %d\n", flock->speciesCount);
+        return NULL;
+    }
+
+    Strips* s = calloc(1, sizeof(Strips));
+    if (!s)
+        return NULL;
+
+    s->count = strips;
+    s->pids = calloc(strips, sizeof(pid_t));
+    s->fds = malloc(strips * sizeof(int));
+    s->counts = calloc(strips, sizeof(int));
+    int (*control)[2] = malloc(strips * sizeof(*control));
+    int (*edges)[2] = malloc(strips * sizeof(*edges)); // edge k joins strip k and the one below
+
+    int ok = s->pids && s->fds && s->counts && control && edges;
+    for (int k = 0; ok && k < strips; k++) {
+        ok = socketpair(AF_UNIX, SOCK_STREAM, 0, control[k]) == 0;
+        if (ok && strips > 1)
+            ok = socketpair(AF_UNIX, SOCK_STREAM, 0, edges[k]) == 0;
+        else
+            edges[k][0] = edges[k][1] = -1;
+    }
+
+    if (!ok) {
+        fprintf(stderr, "strips: cannot create sockets\n");
+        free(control);
+        free(edges);
+        free(s->pids);
+        free(s->fds);
+        free(s->counts);
+        free(s);
+        return NULL;
+    }
+
+    fflush(NULL);
+
+    for (int k = 0; k < strips; k++) {
+        pid_t pid = fork();
+
+        if (pid == 0) {
+            Worker w = {0};
+            w.strip = k;
+            w.strips = strips;
+            w.width = flock->width;
+            w.height = flock->height;
+            w.control = control[k][1];
+            w.down = edges[k][0];
+            w.up = edges[(k + strips - 1) % strips][1];
+            w.lastUpdate = flock->lastUpdate;
+
+            // only our own sockets stay open, so a dead peer reads as EOF
+            for (int j = 0; j < strips; j++) {
+                close(control[j][0]);
+                if (j != k)
+                    close(control[j][1]);
+                if (edges[j][0] >= 0 && edges[j][0] != w.down)
+                    close(edges[j][0]);
+                if (edges[j][1] >= 0 && edges[j][1] != w.up)
+                    close(edges[j][1]);
+            }
+
+            // share the cores instead of every worker starting one thread each
+            int threads = omp_get_num_procs() / strips;
+            omp_set_num_threads(threads > 0 ? threads : 1);
+
+            workerMain(&w, flock);
+            _exit(0);
+        }
+
+        s->pids[k] = pid;
+        s->fds[k] = control[k][0];
+        close(control[k][1]);
+    }
+
+    for (int k = 0; k < strips; k++) {
+        if (edges[k][0] >= 0) {
+            close(edges[k][0]);
+            close(edges[k][1]);
+        }
+    }
+
+    free(control);
+    free(edges);
+
+    for (int k = 0; k < strips; k++) {
+        if (s->pids[k] < 0) {
+            fprintf(stderr, "strips: fork failed\n");
+            stripsStop(s);
+            return NULL;
+        }
+    }
+
+    return s;
+}
+
+int stripsStep(Strips* s, double now) {
+    Message m = {CMD_STEP, 0, now};
+
+    for (int k = 0; k < s->count; k++)
+        if (writeAll(s->fds[k], &m, sizeof(m)))
+            return -1;
+
+    // every worker answering is the step barrier
+    int ok = 1;
+    for (int k = 0; k < s->count; k++) {
+        Message reply;
+        if (readAll(s->fds[k], &reply, sizeof(reply)) || reply.type != REPLY_DONE || reply.count == UINT32_MAX)
+            ok = 0;
+        else
+            s->counts[k] = (int)reply.count;
+    }
+
+    return ok ? 0 : -1;
+}
+
+int stripsGather(Strips* s, Flock* out) {
+    Message m = {CMD_GATHER, 0, 0};
+    StripBoid* boids = NULL;
+    int gathered = 0;
+
+    for (int k = 0; k < s->count; k++)
+        if (writeAll(s->fds[k], &m, sizeof(m)))
+            return -1;
+
+    for (int k = 0; k < s->count; k++) {
+        Message reply;
+        if (readAll(s->fds[k], &reply, sizeof(reply)) || reply.type != REPLY_BOIDS)
+            break;
+
+        StripBoid* more = realloc(boids, (reply.count ? reply.count : 1) * sizeof(StripBoid));
+        if (!more || readAll(s->fds[k], more, reply.count * sizeof(StripBoid))) {
+            free(more);
+            boids = NULL;
+            break;
+        }
+        boids = more;
+
+        for (uint32_t i = 0; i < reply.count; i++) {
+            const StripBoid* b = &boids[i];
+            if (b->id >= (uint32_t)out->count)
+                continue;
+            out->x[b->id] = b->x;
+            out->y[b->id] = b->y;
+            out->rotation[b->id] = b->rotation;
+            out->speedX[b->id] = b->speedX;
+            out->speedY[b->id] = b->speedY;
+            out->angularVelocity[b->id] = b->angularVelocity;
+            gathered++;
+        }
+        out->lastUpdate = reply.now;
+    }
+
+    free(boids);
+    return gathered == out->count ? 0 : -1;
+}
+
+int stripsCounts(const Strips* s, int* counts) {
+    memcpy(counts, s->counts, s->count * sizeof(int));
+    return s->count;
+}
+
+void stripsStop(Strips* s) {
+    if (!s)
+        return;
+
+    Message m = {CMD_STOP, 0, 0};
+
+    for (int k = 0; k < s->count; k++) {
+        if (s->pids[k] > 0) {
+            writeAll(s->fds[k], &m, sizeof(m));
+            close(s->fds[k]);
+            waitpid(s->pids[k], NULL, 0);
+        }
+    }
+
+    free(s->pids);
+    free(s->fds);
+    free(s->counts);
+    free(s);
+}
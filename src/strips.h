@@ -0,0 +1,35 @@
+#pragma once
+#include <stdint.h>
+#include "flock.h"
+
+// Multi-process domain decomposition: the world is cut into horizontal
+// strips, each simulated by its own forked worker process.
+//
+// Every step the coordinator sends the step time to all workers and waits
+// for all of them to answer, which is the step barrier. In between, each
+// worker swaps halos with the strips above and below over Unix domain
+// socket pairs: copies of its boids within a neighbor radius of the shared
+// border. It then steps its own boids synchronously, reading them and the
+// halo as they were at the start of the step. Boids that ended up in
+// another strip migrate to it. Strips form a ring so boids wrapping
+// vertically move between the first and last strip; neighbor distances do
+// not wrap, so no halo crosses that seam.
+//
+// Each worker keeps its boids ordered by global id, so neighbor searches
+// see candidates in the same order as one process stepping the whole
+// flock with Flock.synchronous set, and the results are bit-identical.
+typedef struct StripBoid {
+    uint32_t id;
+    float x, y, rotation;
+    float speedX, speedY, angularVelocity;
+} StripBoid;
+
+typedef struct Strips Strips;
+
+// forks the workers, boid ids are flock indices. Call before the parent runs
+// any OpenMP region, libgomp's thread pool does not survive fork.
+Strips* stripsStart(const Flock* flock, int strips);
+int stripsStep(Strips* s, double now);
+int stripsGather(Strips* s, Flock* out); // copies every boid back into out by id
+int stripsCounts(const Strips* s, int* counts); // boids per strip after the last step
+void stripsStop(Strips* s);
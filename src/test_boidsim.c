@@ -0,0 +1,103 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <omp.h>
+#include "boidsim.h"
+
+// The libboidsim.a API, linked with no raylib or GL: argument checks, set
+// and get round trips, serial and parallel steppers agreeing when the
+// team has one thread, and boids staying in the world on a full team.
+
+#define COUNT 2000
+#define STEPS 120
+#define WORLD_WIDTH 800
+#define WORLD_HEIGHT 600
+
+static int failures;
+
+static void check(int ok, const char* what) {
+    if (!ok) {
+        printf("FAILED: %s\n", what);
+        failures++;
+    }
+}
+
+static unsigned int seed = 42690;
+
+static float random01(void) {
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) * (1.0f / 16777216.0f);
+}
+
+static BoidSim* createPlaced(BoidSimStepper stepper) {
+    BoidSim* sim = boidsimCreate(COUNT, WORLD_WIDTH, WORLD_HEIGHT, stepper);
+
+    seed = 42690;
+    for (int i = 0; sim && i < COUNT; i++) {
+        BoidSimBoid b = {random01() * WORLD_WIDTH, random01() * WORLD_HEIGHT, random01() * 6, 20, 20, 1};
+        boidsimSetBoid(sim, i, &b);
+    }
+
+    return sim;
+}
+
+static int sameBoids(const BoidSim* a, const BoidSim* b) {
+    for (int i = 0; i < COUNT; i++) {
+        BoidSimBoid x, y;
+        boidsimGetBoid(a, i, &x);
+        boidsimGetBoid(b, i, &y);
+        if (memcmp(&x, &y, sizeof(x)))
+            return 0;
+    }
+    return 1;
+}
+
+int main(void) {
+    check(boidsimApiVersion() == BOIDSIM_API_VERSION, "library and header versions match");
+    check(!boidsimCreate(-1, 100, 100, BOIDSIM_SERIAL), "negative count is rejected");
+    check(!boidsimCreate(10, 0, 100, BOIDSIM_SERIAL), "empty world is rejected");
+    check(!boidsimCreate(10, 100, 100, (BoidSimStepper)7), "unknown stepper is rejected");
+
+    BoidSim* sim = createPlaced(BOIDSIM_SERIAL);
+    check(sim && boidsimCount(sim) == COUNT, "create");
+    if (!sim)
+        return 1;
+
+    BoidSimBoid in = {12.5f, 300, 1.25f, 30, 40, 2}, out;
+    check(boidsimSetBoid(sim, 7, &in) == 0 && boidsimGetBoid(sim, 7, &out) == 0 && !memcmp(&in, &out, sizeof(in)), "set and get round trip");
+    check(boidsimSetBoid(sim, COUNT, &in) == -1 && boidsimGetBoid(sim, -1, &out) == -1, "out of range index is rejected");
+    check(boidsimSetStepper(sim, (BoidSimStepper)-1) == -1, "unknown stepper is rejected on switch");
+    check(boidsimStep(sim, -1) == -1, "negative dt is rejected");
+    boidsimDestroy(sim);
+
+    // one thread takes the parallel loop in index order too
+    int threads = omp_get_max_threads();
+    BoidSim* serial = createPlaced(BOIDSIM_SERIAL);
+    BoidSim* parallel = createPlaced(BOIDSIM_PARALLEL);
+    omp_set_num_threads(1);
+    for (int s = 0; s < STEPS; s++) {
+        boidsimStep(serial, 1.0 / 60);
+        boidsimStep(parallel, 1.0 / 60);
+    }
+    omp_set_num_threads(threads);
+    check(sameBoids(serial, parallel), "serial and one-thread parallel steppers agree");
+
+    // switching steppers mid run, on the full team
+    int inside = 1;
+    for (int s = 0; s < STEPS; s++) {
+        boidsimSetStepper(parallel, s % 2 ? BOIDSIM_SERIAL : BOIDSIM_PARALLEL);
+        boidsimStep(parallel, 1.0 / 60);
+    }
+    for (int i = 0; i < COUNT; i++) {
+        boidsimGetBoid(parallel, i, &out);
+        inside &= out.x >= 0 && out.x < WORLD_WIDTH && out.y >= 0 && out.y < WORLD_HEIGHT;
+    }
+    check(inside, "boids stay inside the world");
+    check(boidsimTime(parallel) > 2 * STEPS / 60.0 - 1e-9, "time advances by every dt");
+
+    boidsimDestroy(serial);
+    boidsimDestroy(parallel);
+
+    printf(failures ? "boidsim: FAILED\n" : "boidsim: ok\n");
+    return failures != 0;
+}
@@ -35,8 +35,8 @@ int main(void) {
     // Initialize boids
     for (int i = 0; i < BOIDS; i++) {
         flock[i] = newBoid(
-            (Vector2){GetRandomValue(0, WIDTH), GetRandomValue(0, HEIGHT)},
-            (Vector2){20, 20},
+            (BoidVec2){GetRandomValue(0, WIDTH), GetRandomValue(0, HEIGHT)},
+            (BoidVec2){20, 20},
             GetRandomValue(0, 6),
             1);
     }
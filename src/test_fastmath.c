@@ -0,0 +1,88 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include "fastmath.h"
+
+// Accuracy of fastmath.h against double precision libm. Sweeps the block
+// functions, so the vectorized code paths are the ones checked, and fails
+// when an error goes past the bound documented in the header.
+
+#define SAMPLES (1 << 22)
+#define SIN_BOUND 1e-7
+#define ATAN2_BOUND 3e-7
+
+static float inputs[SAMPLES], inputs2[SAMPLES], out1[SAMPLES], out2[SAMPLES];
+
+static int report(const char* name, double error, double where, double bound) {
+    int ok = error <= bound;
+    printf("%-8s max error %.3g at %.9g (bound %.3g) %s\n", name, error, where, bound, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static int checkSinCos(float range) {
+    double sinError = 0, cosError = 0, sinAt = 0, cosAt = 0;
+
+    for (int i = 0; i < SAMPLES; i++)
+        inputs[i] = -range + 2 * range * i / (float)(SAMPLES - 1);
+    sinCosBlock(inputs, out1, out2, SAMPLES);
+
+    for (int i = 0; i < SAMPLES; i++) {
+        double e = fabs(out1[i] - sin((double)inputs[i]));
+        if (e > sinError) {
+            sinError = e;
+            sinAt = inputs[i];
+        }
+        e = fabs(out2[i] - cos((double)inputs[i]));
+        if (e > cosError) {
+            cosError = e;
+            cosAt = inputs[i];
+        }
+    }
+
+    printf("|x| <= %g\n", range);
+    return report("sin", sinError, sinAt, SIN_BOUND) + report("cos", cosError, cosAt, SIN_BOUND);
+}
+
+static int checkAtan2(void) {
+    double error = 0, at = 0;
+    int n = 0;
+
+    // every direction at radii from tiny to large, plus the axes and zeros
+    for (int i = 0; n < SAMPLES - 16; i++) {
+        double angle = -M_PI + 2 * M_PI * (i % 65536) / 65536.0;
+        double radius = pow(10.0, (i / 65536) % 12 - 6);
+        inputs[n] = (float)(radius * sin(angle));
+        inputs2[n] = (float)(radius * cos(angle));
+        n++;
+    }
+
+    float axes[][2] = {{0, 1}, {0, -1}, {1, 0}, {-1, 0}, {0, 0}, {-0.0f, 0}, {0, -0.0f}, {-0.0f, -0.0f},
+                       {1, 1}, {-1, 1}, {1, -1}, {-1, -1}, {1e-30f, 1}, {1, 1e-30f}, {-1e-30f, -1}, {3e30f, -3e30f}};
+    for (int k = 0; k < 16; k++, n++) {
+        inputs[n] = axes[k][0];
+        inputs2[n] = axes[k][1];
+    }
+
+    atan2Block(inputs, inputs2, out1, n);
+
+    for (int i = 0; i < n; i++) {
+        double e = fabs(out1[i] - atan2((double)inputs[i], (double)inputs2[i]));
+        if (e > error) {
+            error = e;
+            at = atan2((double)inputs[i], (double)inputs2[i]);
+        }
+    }
+
+    return report("atan2", error, at, ATAN2_BOUND);
+}
+
+int main(void) {
+    int failed = 0;
+
+    failed += checkSinCos(2 * M_PI);
+    failed += checkSinCos(8192);
+    failed += checkAtan2();
+
+    printf(failed ? "fastmath: FAILED\n" : "fastmath: ok\n");
+    return failed != 0;
+}
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "trace.h"
+
+#ifdef BOIDS_TRACE
+
+#define TRACE_MAX_THREADS 256
+#define TRACE_RING_SIZE (1 << 16) // events per thread, oldest are overwritten
+
+typedef struct TraceRecord {
+    uint64_t timestamp; // ns
+    const char* name;
+    char phase; // 'B' or 'E'
+} TraceRecord;
+
+typedef struct TraceRing {
+    TraceRecord records[TRACE_RING_SIZE];
+    uint64_t head; // total events written
+    int tid;
+} TraceRing;
+
+int traceEnabled = 0;
+
+static const char* tracePath;
+static uint64_t traceStart;
+static TraceRing* rings[TRACE_MAX_THREADS];
+static int ringCount;
+static _Thread_local TraceRing* localRing;
+
+static uint64_t traceNow(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// first event on a thread registers its ring, every later one is lock free
+static TraceRing* registerRing(void) {
+    int tid = __atomic_fetch_add(&ringCount, 1, __ATOMIC_RELAXED);
+    if (tid >= TRACE_MAX_THREADS)
+        return NULL;
+
+    TraceRing* ring = calloc(1, sizeof(TraceRing));
+    if (!ring)
+        return NULL;
+
+    ring->tid = tid;
+    __atomic_store_n(&rings[tid], ring, __ATOMIC_RELEASE);
+    return ring;
+}
+
+void traceInit(void) {
+    tracePath = getenv("BOIDS_TRACE");
+    if (!tracePath || !*tracePath)
+        return;
+
+    traceStart = traceNow();
+    traceEnabled = 1;
+}
+
+void traceEvent(const char* name, char phase) {
+    TraceRing* ring = localRing;
+    if (!ring) {
+        ring = localRing = registerRing();
+        if (!ring)
+            return;
+    }
+
+    TraceRecord* record = &ring->records[ring->head & (TRACE_RING_SIZE - 1)];
+    record->timestamp = traceNow();
+    record->name = name;
+    record->phase = phase;
+    ring->head++;
+}
+
+static void writeRing(FILE* fp, TraceRing* ring, int* first) {
+    uint64_t count = ring->head < TRACE_RING_SIZE ? ring->head : TRACE_RING_SIZE;
+    uint64_t begin = ring->head - count;
+    int depth = 0;
+
+    fprintf(fp, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+            *first ? "" : ",\n", ring->tid, ring->tid ? "worker" : "main", ring->tid);
+    *first = 0;
+
+    for (uint64_t i = begin; i < ring->head; i++) {
+        TraceRecord* record = &ring->records[i & (TRACE_RING_SIZE - 1)];
+
+        // drop ends whose begin was overwritten by the ring
+        if (record->phase == 'E' && depth == 0)
+            continue;
+        depth += record->phase == 'B' ? 1 : -1;
+
+        fprintf(fp, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f}",
+                record->name, record->phase, ring->tid,
+                (record->timestamp - traceStart) / 1000.0);
+    }
+}
+
+void traceShutdown(void) {
+    if (!traceEnabled)
+        return;
+    traceEnabled = 0;
+
+    FILE* fp = fopen(tracePath, "w");
+    if (!fp) {
+        fprintf(stderr, "trace: cannot open %s\n", tracePath);
+        return;
+    }
+
+    int threads = ringCount < TRACE_MAX_THREADS ? ringCount : TRACE_MAX_THREADS;
+    int first = 1;
+
+    fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (int i = 0; i < threads; i++) {
+        TraceRing* ring = __atomic_load_n(&rings[i], __ATOMIC_ACQUIRE);
+        if (ring)
+            writeRing(fp, ring, &first);
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+
+    printf("Trace written to %s (%d threads)\n", tracePath, threads);
+
+    for (int i = 0; i < threads; i++) {
+        free(rings[i]);
+        rings[i] = NULL;
+    }
+}
+
+#endif
@@ -0,0 +1,33 @@
+#pragma once
+
+// Lightweight per-thread zone tracing exported as Chrome trace-event JSON
+// (open in chrome://tracing or ui.perfetto.dev).
+//
+// Zones are compiled in with -DBOIDS_TRACE and recorded only when the
+// BOIDS_TRACE environment variable names an output file. Without the define
+// every macro expands to nothing; with it but disabled at runtime each zone
+// costs one predictable branch on a global flag.
+//
+// Zone names must be string literals, only the pointer is stored.
+
+#ifdef BOIDS_TRACE
+
+extern int traceEnabled;
+
+void traceInit(void);
+void traceShutdown(void);
+void traceEvent(const char* name, char phase);
+
+#define TRACE_INIT() traceInit()
+#define TRACE_SHUTDOWN() traceShutdown()
+#define TRACE_BEGIN(name) do { if (traceEnabled) traceEvent((name), 'B'); } while (0)
+#define TRACE_END(name) do { if (traceEnabled) traceEvent((name), 'E'); } while (0)
+
+#else
+
+#define TRACE_INIT() ((void)0)
+#define TRACE_SHUTDOWN() ((void)0)
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END(name) ((void)0)
+
+#endif
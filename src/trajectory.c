@@ -0,0 +1,590 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "trajectory.h"
+
+#define RECORDER_BUFFERS 4
+#define QUANT_SCALE 65536.0f
+#define TURN (2*M_PI)
+
+struct Recorder {
+    FILE* fp;
+    TrajectoryHeader header;
+
+    // encoder state, sim thread only
+    uint16_t* previous[TRAJECTORY_COLUMNS];
+    uint16_t* values;
+    uint8_t* widths;
+    size_t* offsets;
+    uint32_t frames;
+    uint64_t dropped;
+
+    // buffers handed to the writer, a queue of `filled` slots from `head`
+    uint8_t* buffers[RECORDER_BUFFERS];
+    size_t sizes[RECORDER_BUFFERS];
+    size_t capacity;
+    int head;
+    int filled;
+    int closing;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    // writer thread only
+    uint64_t fileOffset;
+    TrajectoryIndexEntry* index;
+    size_t indexCount;
+    size_t indexCapacity;
+    int writeError;
+};
+
+struct TrajectoryReader {
+    const uint8_t* base;
+    size_t size;
+    TrajectoryHeader header;
+    TrajectoryIndexEntry* index;
+    size_t indexCount;
+    int frames;
+
+    uint16_t* current[TRAJECTORY_COLUMNS];
+    uint16_t* values;
+    size_t* offsets;
+    int position; // last decoded frame, -1 if none
+    uint64_t nextOffset;
+    double time;
+};
+
+// codec
+
+static int blockCount(int count) {
+    return (count + TRAJECTORY_BLOCK - 1) / TRAJECTORY_BLOCK;
+}
+
+static int blockLength(int count, int block) {
+    int start = block * TRAJECTORY_BLOCK;
+    return count - start < TRAJECTORY_BLOCK ? count - start : TRAJECTORY_BLOCK;
+}
+
+static size_t columnBound(int count) {
+    return (size_t)blockCount(count) + (size_t)count * sizeof(uint16_t) + 8;
+}
+
+static uint16_t zigzag(uint16_t delta) {
+    int16_t v = (int16_t)delta;
+    return (uint16_t)((v << 1) ^ (v >> 15));
+}
+
+static uint16_t unzigzag(uint16_t v) {
+    return (uint16_t)((v >> 1) ^ -(v & 1));
+}
+
+static int bitWidth(uint16_t v) {
+    return v ? 32 - __builtin_clz(v) : 0;
+}
+
+static uint16_t quantize(float value, float scale) {
+    return (uint16_t)(int32_t)lrintf(value * scale);
+}
+
+static void packBlock(const uint16_t* values, int length, int width, uint8_t* out) {
+    uint64_t acc = 0;
+    int bits = 0;
+
+    for (int i = 0; i < length; i++) {
+        acc |= (uint64_t)values[i] << bits;
+        bits += width;
+
+        while (bits >= 8) {
+            *out++ = (uint8_t)acc;
+            acc >>= 8;
+            bits -= 8;
+        }
+    }
+
+    if (bits > 0)
+        *out = (uint8_t)acc;
+}
+
+static void unpackBlock(const uint8_t* in, int length, int width, uint16_t* values) {
+    uint64_t acc = 0;
+    int bits = 0;
+    uint16_t mask = (uint16_t)((1u << width) - 1);
+
+    for (int i = 0; i < length; i++) {
+        while (bits < width) {
+            acc |= (uint64_t)*in++ << bits;
+            bits += 8;
+        }
+
+        values[i] = (uint16_t)acc & mask;
+        acc >>= width;
+        bits -= width;
+    }
+}
+
+// widths byte per block, then the blocks, each byte aligned
+static size_t packColumn(const uint16_t* values, int count, uint8_t* widths, size_t* offsets, uint8_t* out) {
+    int blocks = blockCount(count);
+
+    #pragma omp parallel for schedule(static)
+    for (int b = 0; b < blocks; b++) {
+        const uint16_t* block = values + (size_t)b * TRAJECTORY_BLOCK;
+        int length = blockLength(count, b);
+        uint16_t all = 0;
+
+        for (int i = 0; i < length; i++)
+            all |= block[i];
+        widths[b] = (uint8_t)bitWidth(all);
+    }
+
+    size_t position = blocks;
+    for (int b = 0; b < blocks; b++) {
+        offsets[b] = position;
+        position += ((size_t)blockLength(count, b) * widths[b] + 7) / 8;
+    }
+
+    memcpy(out, widths, blocks);
+
+    #pragma omp parallel for schedule(static)
+    for (int b = 0; b < blocks; b++)
+        packBlock(values + (size_t)b * TRAJECTORY_BLOCK, blockLength(count, b), widths[b], out + offsets[b]);
+
+    return position;
+}
+
+// returns bytes consumed, 0 if the column runs past end
+static size_t unpackColumn(const uint8_t* in, const uint8_t* end, int count, size_t* offsets, uint16_t* values) {
+    int blocks = blockCount(count);
+    size_t position = blocks;
+
+    if ((size_t)(end - in) < position)
+        return 0;
+
+    for (int b = 0; b < blocks; b++) {
+        if (in[b] > 16)
+            return 0;
+        offsets[b] = position;
+        position += ((size_t)blockLength(count, b) * in[b] + 7) / 8;
+    }
+
+    if ((size_t)(end - in) < position)
+        return 0;
+
+    #pragma omp parallel for schedule(static)
+    for (int b = 0; b < blocks; b++)
+        unpackBlock(in + offsets[b], blockLength(count, b), in[b], values + (size_t)b * TRAJECTORY_BLOCK);
+
+    return position;
+}
+
+// recorder
+
+static void* writerMain(void* arg) {
+    Recorder* rec = arg;
+
+    for (;;) {
+        pthread_mutex_lock(&rec->lock);
+        while (!rec->filled && !rec->closing)
+            pthread_cond_wait(&rec->cond, &rec->lock);
+
+        if (!rec->filled) {
+            pthread_mutex_unlock(&rec->lock);
+            break;
+        }
+
+        int slot = rec->head;
+        pthread_mutex_unlock(&rec->lock);
+
+        const TrajectoryFrame* frame = (const TrajectoryFrame*)rec->buffers[slot];
+        if (frame->keyframe) {
+            if (rec->indexCount == rec->indexCapacity) {
+                size_t capacity = rec->indexCapacity ? rec->indexCapacity * 2 : 64;
+                TrajectoryIndexEntry* index = realloc(rec->index, capacity * sizeof(TrajectoryIndexEntry));
+                if (index) {
+                    rec->index = index;
+                    rec->indexCapacity = capacity;
+                }
+            }
+
+            if (rec->indexCount < rec->indexCapacity)
+                rec->index[rec->indexCount++] = (TrajectoryIndexEntry){frame->index, rec->fileOffset};
+        }
+
+        if (fwrite(rec->buffers[slot], 1, rec->sizes[slot], rec->fp) != rec->sizes[slot])
+            rec->writeError = 1;
+        rec->fileOffset += rec->sizes[slot];
+
+        pthread_mutex_lock(&rec->lock);
+        rec->head = (rec->head + 1) % RECORDER_BUFFERS;
+        rec->filled--;
+        pthread_mutex_unlock(&rec->lock);
+    }
+
+    return NULL;
+}
+
+Recorder* recorderOpen(const char* path, const Flock* flock, int keyframeInterval) {
+    Recorder* rec = calloc(1, sizeof(Recorder));
+    if (!rec)
+        return NULL;
+
+    rec->fp = fopen(path, "wb");
+    if (!rec->fp) {
+        fprintf(stderr, "recorder: cannot open %s\n", path);
+        free(rec);
+        return NULL;
+    }
+
+    memcpy(rec->header.magic, TRAJECTORY_MAGIC, sizeof(rec->header.magic));
+    rec->header.version = TRAJECTORY_VERSION;
+    rec->header.count = (uint32_t)flock->count;
+    rec->header.width = flock->width;
+    rec->header.height = flock->height;
+    rec->header.keyframeInterval = keyframeInterval > 0 ? keyframeInterval : 60;
+    rec->header.blockSize = TRAJECTORY_BLOCK;
+
+    int ok = 1;
+    for (int c = 0; c < TRAJECTORY_COLUMNS; c++)
+        ok = ok && (rec->previous[c] = calloc(flock->count + 1, sizeof(uint16_t)));
+    ok = ok && (rec->values = malloc((flock->count + 1) * sizeof(uint16_t)));
+    ok = ok && (rec->widths = malloc(blockCount(flock->count) + 1));
+    ok = ok && (rec->offsets = malloc((blockCount(flock->count) + 1) * sizeof(size_t)));
+
+    rec->capacity = sizeof(TrajectoryFrame) + TRAJECTORY_COLUMNS * columnBound(flock->count);
+    for (int i = 0; i < RECORDER_BUFFERS; i++)
+        ok = ok && (rec->buffers[i] = malloc(rec->capacity));
+
+    ok = ok && fwrite(&rec->header, sizeof(rec->header), 1, rec->fp) == 1;
+    rec->fileOffset = sizeof(rec->header);
+
+    pthread_mutex_init(&rec->lock, NULL);
+    pthread_cond_init(&rec->cond, NULL);
+    ok = ok && pthread_create(&rec->thread, NULL, writerMain, rec) == 0;
+
+    if (!ok) {
+        fprintf(stderr, "recorder: setup failed for %s\n", path);
+        fclose(rec->fp);
+        for (int c = 0; c < TRAJECTORY_COLUMNS; c++)
+            free(rec->previous[c]);
+        for (int i = 0; i < RECORDER_BUFFERS; i++)
+            free(rec->buffers[i]);
+        free(rec->values);
+        free(rec->widths);
+        free(rec->offsets);
+        free(rec);
+        return NULL;
+    }
+
+    return rec;
+}
+
+void recorderPush(Recorder* rec, const Flock* flock) {
+    pthread_mutex_lock(&rec->lock);
+    int full = rec->filled == RECORDER_BUFFERS;
+    int slot = (rec->head + rec->filled) % RECORDER_BUFFERS;
+    pthread_mutex_unlock(&rec->lock);
+
+    // never wait on the disk, the next frame deltas against the last queued one
+    if (full) {
+        rec->dropped++;
+        return;
+    }
+
+    int count = (int)rec->header.count;
+    int keyframe = rec->frames % rec->header.keyframeInterval == 0;
+    const float* columns[TRAJECTORY_COLUMNS] = {flock->x, flock->y, flock->rotation};
+    const float scales[TRAJECTORY_COLUMNS] = {
+        QUANT_SCALE / rec->header.width, QUANT_SCALE / rec->header.height, QUANT_SCALE / TURN
+    };
+
+    uint8_t* buffer = rec->buffers[slot];
+    size_t size = sizeof(TrajectoryFrame);
+
+    for (int c = 0; c < TRAJECTORY_COLUMNS; c++) {
+        const float* column = columns[c];
+        uint16_t* previous = rec->previous[c];
+        uint16_t* values = rec->values;
+        float scale = scales[c];
+
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < count; i++) {
+            uint16_t q = quantize(column[i], scale);
+            values[i] = keyframe ? q : zigzag((uint16_t)(q - previous[i]));
+            previous[i] = q;
+        }
+
+        size += packColumn(values, count, rec->widths, rec->offsets, buffer + size);
+    }
+
+    // keep frame headers 8-byte aligned in the file
+    while (size % 8)
+        buffer[size++] = 0;
+
+    *(TrajectoryFrame*)buffer = (TrajectoryFrame){
+        rec->frames, (uint32_t)keyframe, size - sizeof(TrajectoryFrame), flock->lastUpdate
+    };
+    rec->frames++;
+
+    pthread_mutex_lock(&rec->lock);
+    rec->sizes[slot] = size;
+    rec->filled++;
+    pthread_cond_signal(&rec->cond);
+    pthread_mutex_unlock(&rec->lock);
+}
+
+void recorderClose(Recorder* rec) {
+    if (!rec)
+        return;
+
+    pthread_mutex_lock(&rec->lock);
+    rec->closing = 1;
+    pthread_cond_signal(&rec->cond);
+    pthread_mutex_unlock(&rec->lock);
+    pthread_join(rec->thread, NULL);
+
+    TrajectoryTrailer trailer = {{0}, rec->fileOffset, rec->indexCount, rec->frames};
+    memcpy(trailer.magic, TRAJECTORY_INDEX_MAGIC, sizeof(trailer.magic));
+
+    int ok = !rec->writeError;
+    ok = ok && fwrite(rec->index, sizeof(TrajectoryIndexEntry), rec->indexCount, rec->fp) == rec->indexCount;
+    ok = ok && fwrite(&trailer, sizeof(trailer), 1, rec->fp) == 1;
+    ok = fclose(rec->fp) == 0 && ok;
+
+    double raw = (double)rec->frames * rec->header.count * TRAJECTORY_COLUMNS * sizeof(float);
+    printf("Recorded %u frames (%llu dropped), %.1f MB, %.2fx smaller than raw floats%s\n",
+           rec->frames, (unsigned long long)rec->dropped, rec->fileOffset / 1e6,
+           rec->fileOffset ? raw / rec->fileOffset : 0.0, ok ? "" : ", WRITE FAILED");
+
+    pthread_mutex_destroy(&rec->lock);
+    pthread_cond_destroy(&rec->cond);
+    for (int c = 0; c < TRAJECTORY_COLUMNS; c++)
+        free(rec->previous[c]);
+    for (int i = 0; i < RECORDER_BUFFERS; i++)
+        free(rec->buffers[i]);
+    free(rec->values);
+    free(rec->widths);
+    free(rec->offsets);
+    free(rec->index);
+    free(rec);
+}
+
+// reader
+
+static const TrajectoryFrame* frameAt(const TrajectoryReader* reader, uint64_t offset) {
+    if (offset + sizeof(TrajectoryFrame) > reader->size)
+        return NULL;
+
+    const TrajectoryFrame* frame = (const TrajectoryFrame*)(reader->base + offset);
+    if (frame->size > reader->size - offset - sizeof(TrajectoryFrame))
+        return NULL;
+
+    return frame;
+}
+
+// unfinished recordings have no trailer, walk the frames instead
+static int scanFrames(TrajectoryReader* reader) {
+    uint64_t offset = sizeof(TrajectoryHeader);
+    size_t capacity = 0;
+    const TrajectoryFrame* frame;
+
+    while ((frame = frameAt(reader, offset)) && frame->index == (uint32_t)reader->frames) {
+        if (frame->keyframe) {
+            if (reader->indexCount == capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                TrajectoryIndexEntry* index = realloc(reader->index, capacity * sizeof(TrajectoryIndexEntry));
+                if (!index)
+                    return -1;
+                reader->index = index;
+            }
+            reader->index[reader->indexCount++] = (TrajectoryIndexEntry){frame->index, offset};
+        }
+
+        reader->frames++;
+        offset += sizeof(TrajectoryFrame) + frame->size;
+    }
+
+    return 0;
+}
+
+TrajectoryReader* trajectoryOpen(const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "trajectory: cannot open %s\n", path);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TrajectoryHeader)) {
+        fprintf(stderr, "trajectory: %s is too small\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "trajectory: cannot map %s\n", path);
+        return NULL;
+    }
+
+    TrajectoryReader* reader = calloc(1, sizeof(TrajectoryReader));
+    reader->base = base;
+    reader->size = st.st_size;
+    reader->header = *(const TrajectoryHeader*)base;
+    reader->position = -1;
+
+    const TrajectoryHeader* header = &reader->header;
+    if (memcmp(header->magic, TRAJECTORY_MAGIC, sizeof(header->magic)) || header->version != TRAJECTORY_VERSION
+        || header->blockSize != TRAJECTORY_BLOCK || header->count > INT32_MAX - 1) {
+        fprintf(stderr, "trajectory: %s is not a version %d trajectory\n", path, TRAJECTORY_VERSION);
+        trajectoryClose(reader);
+        return NULL;
+    }
+
+    const TrajectoryTrailer* trailer = NULL;
+    if (reader->size >= sizeof(TrajectoryHeader) + sizeof(TrajectoryTrailer))
+        trailer = (const TrajectoryTrailer*)(reader->base + reader->size - sizeof(TrajectoryTrailer));
+
+    if (trailer && !memcmp(trailer->magic, TRAJECTORY_INDEX_MAGIC, sizeof(trailer->magic))
+        && trailer->indexOffset + trailer->indexCount * sizeof(TrajectoryIndexEntry) <= reader->size
+        && trailer->frameCount <= INT32_MAX) {
+        reader->indexCount = trailer->indexCount;
+        reader->frames = (int)trailer->frameCount;
+        reader->index = malloc((reader->indexCount + 1) * sizeof(TrajectoryIndexEntry));
+        if (reader->index)
+            memcpy(reader->index, reader->base + trailer->indexOffset, reader->indexCount * sizeof(TrajectoryIndexEntry));
+    } else if (scanFrames(reader)) {
+        trajectoryClose(reader);
+        return NULL;
+    }
+
+    int count = (int)header->count;
+    int ok = reader->index || !reader->indexCount;
+    for (int c = 0; c < TRAJECTORY_COLUMNS; c++)
+        ok = ok && (reader->current[c] = calloc(count + 1, sizeof(uint16_t)));
+    ok = ok && (reader->values = malloc((count + 1) * sizeof(uint16_t)));
+    ok = ok && (reader->offsets = malloc((blockCount(count) + 1) * sizeof(size_t)));
+
+    if (!ok) {
+        trajectoryClose(reader);
+        return NULL;
+    }
+
+    return reader;
+}
+
+int trajectoryCount(const TrajectoryReader* reader) {
+    return (int)reader->header.count;
+}
+
+int trajectoryFrames(const TrajectoryReader* reader) {
+    return reader->frames;
+}
+
+const TrajectoryHeader* trajectoryHeader(const TrajectoryReader* reader) {
+    return &reader->header;
+}
+
+double trajectoryTime(const TrajectoryReader* reader) {
+    return reader->time;
+}
+
+static int decodeNext(TrajectoryReader* reader) {
+    const TrajectoryFrame* frame = frameAt(reader, reader->nextOffset);
+    int count = (int)reader->header.count;
+
+    if (!frame || frame->index != (uint32_t)(reader->position + 1) || (!frame->keyframe && reader->position < 0))
+        return -1;
+
+    const uint8_t* in = (const uint8_t*)(frame + 1);
+    const uint8_t* end = in + frame->size;
+
+    for (int c = 0; c < TRAJECTORY_COLUMNS; c++) {
+        size_t used = unpackColumn(in, end, count, reader->offsets, reader->values);
+        if (!used)
+            return -1;
+        in += used;
+
+        uint16_t* current = reader->current[c];
+        const uint16_t* values = reader->values;
+
+        if (frame->keyframe) {
+            memcpy(current, values, count * sizeof(uint16_t));
+        } else {
+            #pragma omp parallel for schedule(static)
+            for (int i = 0; i < count; i++)
+                current[i] = (uint16_t)(current[i] + unzigzag(values[i]));
+        }
+    }
+
+    reader->position = (int)frame->index;
+    reader->nextOffset += sizeof(TrajectoryFrame) + frame->size;
+    reader->time = frame->time;
+    return 0;
+}
+
+int trajectoryRead(TrajectoryReader* reader, int frame, Flock* out) {
+    if (frame < 0 || frame >= reader->frames || !reader->indexCount || out->count != (int)reader->header.count)
+        return -1;
+
+    // latest keyframe at or before the target
+    size_t lo = 0, hi = reader->indexCount;
+    while (hi - lo > 1) {
+        size_t mid = (lo + hi) / 2;
+        if (reader->index[mid].frame <= (uint64_t)frame)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    const TrajectoryIndexEntry* key = &reader->index[lo];
+    if (key->frame > (uint64_t)frame)
+        return -1;
+
+    // keep decoding forward when that is shorter than a seek
+    if (reader->position > frame || reader->position < (int)key->frame) {
+        reader->position = (int)key->frame - 1;
+        reader->nextOffset = key->offset;
+    }
+
+    while (reader->position < frame)
+        if (decodeNext(reader)) {
+            reader->position = -1;
+            return -1;
+        }
+
+    int count = out->count;
+    float sx = reader->header.width / QUANT_SCALE;
+    float sy = reader->header.height / QUANT_SCALE;
+    float sr = TURN / QUANT_SCALE;
+
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < count; i++) {
+        out->x[i] = reader->current[0][i] * sx;
+        out->y[i] = reader->current[1][i] * sy;
+        out->rotation[i] = reader->current[2][i] * sr;
+    }
+    out->lastUpdate = reader->time;
+
+    return 0;
+}
+
+void trajectoryClose(TrajectoryReader* reader) {
+    if (!reader)
+        return;
+
+    munmap((void*)reader->base, reader->size);
+    for (int c = 0; c < TRAJECTORY_COLUMNS; c++)
+        free(reader->current[c]);
+    free(reader->values);
+    free(reader->offsets);
+    free(reader->index);
+    free(reader);
+}
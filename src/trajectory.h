@@ -0,0 +1,71 @@
+#pragma once
+#include <stdint.h>
+#include "flock.h"
+
+// Streaming trajectory files: every boid, every recorded frame.
+//
+// Positions are quantized to a 2^16 x 2^16 grid over the world and headings
+// to 2^16 units per turn, so wrap-around is plain 16-bit overflow. Each
+// column (x, y, rotation) is delta encoded against the previous recorded
+// frame, zigzag mapped and bit-packed in blocks of TRAJECTORY_BLOCK boids
+// with one width byte per block. Every keyframeInterval frames the absolute
+// values are stored instead, and a keyframe index at the end of the file
+// lets the reader seek.
+//
+//   TrajectoryHeader
+//   frames: TrajectoryFrame + x, y, rotation column payloads
+//   TrajectoryIndexEntry[] for keyframes
+//   TrajectoryTrailer
+//
+// Encoding runs on the calling thread, a dedicated thread does the writes.
+// If the writer falls behind, frames are dropped (and counted) rather than
+// stalling the simulation; deltas always refer to the last queued frame.
+#define TRAJECTORY_MAGIC "BOIDTRAJ"
+#define TRAJECTORY_INDEX_MAGIC "BOIDTIDX"
+#define TRAJECTORY_VERSION 1
+#define TRAJECTORY_BLOCK 1024
+#define TRAJECTORY_COLUMNS 3
+
+typedef struct TrajectoryHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t count;
+    float width;
+    float height;
+    uint32_t keyframeInterval;
+    uint32_t blockSize;
+} TrajectoryHeader;
+
+typedef struct TrajectoryFrame {
+    uint32_t index;
+    uint32_t keyframe;
+    uint64_t size; // payload bytes after this header
+    double time;
+} TrajectoryFrame;
+
+typedef struct TrajectoryIndexEntry {
+    uint64_t frame;
+    uint64_t offset;
+} TrajectoryIndexEntry;
+
+typedef struct TrajectoryTrailer {
+    char magic[8];
+    uint64_t indexOffset;
+    uint64_t indexCount;
+    uint64_t frameCount;
+} TrajectoryTrailer;
+
+typedef struct Recorder Recorder;
+typedef struct TrajectoryReader TrajectoryReader;
+
+Recorder* recorderOpen(const char* path, const Flock* flock, int keyframeInterval);
+void recorderPush(Recorder* recorder, const Flock* flock); // call after each updateFlock
+void recorderClose(Recorder* recorder);
+
+TrajectoryReader* trajectoryOpen(const char* path);
+int trajectoryCount(const TrajectoryReader* reader); // boids per frame
+int trajectoryFrames(const TrajectoryReader* reader);
+const TrajectoryHeader* trajectoryHeader(const TrajectoryReader* reader);
+int trajectoryRead(TrajectoryReader* reader, int frame, Flock* out); // fills x, y, rotation
+double trajectoryTime(const TrajectoryReader* reader); // sim time of the last frame read
+void trajectoryClose(TrajectoryReader* reader);